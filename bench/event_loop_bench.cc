@@ -0,0 +1,74 @@
+// Event-queue microbenchmark: classic "hold" model. N events stay pending;
+// every executed event schedules one successor at now + Exp(mean). Reports
+// events/second for the legacy std::priority_queue<std::function> loop and for
+// both EventLoop engines.
+//
+// Usage: event_loop_bench [events_per_run]
+#include "sim/event_loop.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <queue>
+#include <random>
+
+namespace {
+
+// The pre-calendar EventLoop, kept verbatim as the baseline.
+struct LegacyEvent {
+  double t;
+  std::function<void()> fn;
+  bool operator<(const LegacyEvent& other) const { return t > other.t; }
+};
+struct LegacyLoop {
+  double now{0.0};
+  std::priority_queue<LegacyEvent> pq;
+  void at(double t, std::function<void()> fn){ pq.push(LegacyEvent{t, std::move(fn)}); }
+  void run(){ while (!pq.empty()){ auto e = pq.top(); pq.pop(); now = e.t; e.fn(); } }
+};
+
+// Payload sized like the per-op completion closures in index_sherman.cc.
+struct Payload { std::uint64_t a, b, c, d, e, f, g, h; };
+
+template<class Loop>
+struct Hold {
+  Loop& loop;
+  std::mt19937_64 rng{7};
+  std::exponential_distribution<double> gap{1.0};
+  std::uint64_t remaining;
+  std::uint64_t sink{0};
+  void schedule(){
+    if (remaining == 0) return;
+    --remaining;
+    Payload p{remaining, 1, 2, 3, 4, 5, 6, 7};
+    loop.at(loop.now + gap(rng), [this, p]{ sink += p.a; schedule(); });
+  }
+};
+
+template<class Loop>
+double run_hold(Loop& loop, std::size_t pending, std::uint64_t events){
+  Hold<Loop> h{loop, {}, {}, events};
+  for (std::size_t i = 0; i < pending; ++i) h.schedule();
+  auto t0 = std::chrono::steady_clock::now();
+  loop.run();
+  double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+  if (h.sink == 42) std::printf("#");
+  return double(events) / sec;
+}
+
+} // namespace
+
+int main(int argc, char** argv){
+  const std::uint64_t events = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 2'000'000;
+  std::printf("%10s %16s %16s %16s %8s\n", "pending", "legacy_ev/s", "heap_ev/s", "calendar_ev/s", "speedup");
+  for (std::size_t pending : {16, 256, 4096, 65536, 262144}){
+    LegacyLoop legacy;
+    EventLoop heap(EventQueueKind::Heap);
+    EventLoop cal(EventQueueKind::Calendar);
+    const double r_legacy = run_hold(legacy, pending, events);
+    const double r_heap   = run_hold(heap, pending, events);
+    const double r_cal    = run_hold(cal, pending, events);
+    std::printf("%10zu %16.0f %16.0f %16.0f %7.2fx\n", pending, r_legacy, r_heap, r_cal, r_cal / r_legacy);
+  }
+  return 0;
+}
@@ -0,0 +1,285 @@
+// Host-side microbenchmarks of the simulator's hot data structures, with JSON
+// output for tracking across commits. Each case runs a fixed number of
+// operations over one parameter point and reports ns/op plus case-specific
+// figures (hit ratios, combining ratios, ...).
+//
+//  event_loop/hold         pending events, heap vs calendar engine
+//  node_cache/get_put      zipf node lookups (put on miss); policy, capacity, skew
+//  hopscotch/insert_lookup overlay refills, lookups alternating present/absent keys
+//  zipf/sample             rejection-inversion sampler; keyspace, skew
+//  token_bucket/acquire    offered load relative to the bucket rate
+//  rdwc/read_write         delegation table under zipf keys; keyspace, write share
+//  llt/enqueue_release     local lock queues; waiters per key, keys
+//
+// Usage: sim_bench [--ops N] [--filter SUBSTR] [--label TEXT] [--json PATH]
+// JSON goes to PATH (default: stdout); a table goes to stderr.
+#include "sim/cache.h"
+#include "sim/event_loop.h"
+#include "sim/hopscotch.h"
+#include "sim/locks.h"
+#include "sim/rdma.h"
+#include "sim/rdwc.h"
+#include "sim/zipf.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Makes v observable, so the work that computed it is not optimized away.
+template<class T>
+inline void do_not_optimize(const T& v){ asm volatile("" : : "r,m"(v) : "memory"); }
+
+struct Result {
+  std::string name;
+  std::vector<std::pair<std::string, std::string>> params;
+  std::uint64_t ops{0};
+  double secs{0};
+  std::vector<std::pair<std::string, double>> extra;
+};
+
+struct Bench {
+  std::uint64_t ops{1'000'000};
+  std::string filter;
+  std::vector<Result> results;
+
+  bool wanted(const char* name) const { return filter.empty() || std::strstr(name, filter.c_str()); }
+
+  // Time body(ops) and record it.
+  template<class F>
+  Result& run(const char* name, std::vector<std::pair<std::string, std::string>> params, std::uint64_t n, F&& body){
+    auto t0 = Clock::now();
+    body(n);
+    Result r{name, std::move(params), n, std::chrono::duration<double>(Clock::now() - t0).count(), {}};
+    results.push_back(std::move(r));
+    return results.back();
+  }
+};
+
+std::string str(double v){ char b[32]; std::snprintf(b, sizeof b, "%g", v); return b; }
+std::string str(std::uint64_t v){ return std::to_string(v); }
+
+// Payload sized like the per-op completion closures in index_sherman.cc.
+struct Payload { std::uint64_t a, b, c, d, e, f, g, h; };
+
+void bench_event_loop(Bench& b){
+  for (auto kind : {EventQueueKind::Heap, EventQueueKind::Calendar}){
+    for (std::size_t pending : {16ul, 4096ul, 65536ul}){
+      EventLoop loop(kind);
+      std::mt19937_64 rng(7);
+      std::exponential_distribution<double> gap(1.0);
+      std::uint64_t left = b.ops, acc = 0;
+      struct Hold {
+        EventLoop& loop; std::mt19937_64& rng; std::exponential_distribution<double>& gap;
+        std::uint64_t& left; std::uint64_t& acc;
+        void schedule(){
+          if (!left) return;
+          --left;
+          Payload p{left, 1, 2, 3, 4, 5, 6, 7};
+          loop.at(loop.now + gap(rng), [this, p]{ acc += p.a; schedule(); });
+        }
+      } h{loop, rng, gap, left, acc};
+      for (std::size_t i = 0; i < pending; ++i) h.schedule();
+      b.run("event_loop/hold", {{"engine", kind == EventQueueKind::Heap ? "heap" : "calendar"}, {"pending", str((std::uint64_t)pending)}},
+            b.ops, [&](std::uint64_t){ loop.run(); });
+      do_not_optimize(acc);
+    }
+  }
+}
+
+void bench_node_cache(Bench& b){
+  const std::pair<const char*, CachePolicyKind> policies[] = {
+    {"lru", CachePolicyKind::LRU}, {"clock", CachePolicyKind::Clock},
+    {"s3fifo", CachePolicyKind::S3Fifo}, {"tinylfu", CachePolicyKind::TinyLfu}};
+  for (auto [pname, kind] : policies){
+    for (std::uint64_t entries : {1024ull, 65536ull}){
+      for (double skew : {0.6, 0.99}){
+        NodeCache cache(entries * 1024, kind, 0, 1024);
+        Zipf keys(entries * 8, skew);
+        std::mt19937_64 rng(3);
+        std::uint64_t hits = 0;
+        auto& r = b.run("node_cache/get_put", {{"policy", pname}, {"entries", str(entries)}, {"skew", str(skew)}}, b.ops,
+          [&](std::uint64_t n){
+            for (std::uint64_t i = 0; i < n; ++i){
+              const CacheKey k{keys.sample(rng), 3};
+              if (cache.get(k)) ++hits; else cache.put(k, 1024);
+            }
+          });
+        r.extra.push_back({"hit_ratio", double(hits) / double(b.ops)});
+      }
+    }
+  }
+}
+
+void bench_hopscotch(Bench& b){
+  for (int slots : {32, 64}){
+    for (double fill : {0.5, 0.9}){
+      hopscotch::HopscotchOverlay ov(16, slots);
+      std::mt19937_64 rng(5);
+      const int target = int(fill * slots);
+      std::vector<std::uint64_t> present;
+      std::uint64_t found = 0, failed = 0;
+      auto& r = b.run("hopscotch/insert_lookup", {{"slots", str((std::uint64_t)slots)}, {"fill", str(fill)}}, b.ops,
+        [&](std::uint64_t n){
+          for (std::uint64_t i = 0; i < n; ++i){
+            if (i % 64 == 0){ // refill from empty every 64 lookups (their cost is in ns/op)
+              ov.clear(); present.clear();
+              for (int j = 0; j < target; ++j){ const std::uint64_t k = rng(); if (ov.insert(k, (std::uint16_t)j)) present.push_back(k); else ++failed; }
+            }
+            const std::uint64_t k = (i & 1) && !present.empty() ? present[i % present.size()] : rng();
+            found += ov.lookup(k) >= 0;
+          }
+        });
+      r.extra.push_back({"lookup_hit_ratio", double(found) / double(b.ops)});
+      r.extra.push_back({"insert_failures", double(failed)});
+    }
+  }
+}
+
+void bench_zipf(Bench& b){
+  for (std::uint64_t n : {1'000'000ull, 1'000'000'000ull}){
+    for (double s : {0.6, 0.99, 1.2}){
+      Zipf z(n, s);
+      std::mt19937_64 rng(1);
+      std::uint64_t acc = 0;
+      b.run("zipf/sample", {{"keyspace", str(n)}, {"skew", str(s)}}, b.ops,
+            [&](std::uint64_t k){ for (std::uint64_t i = 0; i < k; ++i) acc += z.sample(rng); });
+      do_not_optimize(acc);
+    }
+  }
+}
+
+void bench_token_bucket(Bench& b){
+  for (double load : {0.5, 1.0, 2.0}){
+    TokenBucket tb;
+    const double rate = 10e6;
+    tb.init(rate, 64, 0);
+    const double gap = 1e6 / (rate * load);
+    std::uint64_t waited = 0;
+    auto& r = b.run("token_bucket/acquire", {{"load", str(load)}}, b.ops,
+      [&](std::uint64_t n){
+        double now = 0;
+        for (std::uint64_t i = 0; i < n; ++i, now += gap) waited += tb.acquire(1, now) > now;
+      });
+    r.extra.push_back({"wait_ratio", double(waited) / double(b.ops)});
+  }
+}
+
+void bench_rdwc(Bench& b){
+  using T = rdwc::DelegationTable;
+  for (std::uint64_t keyspace : {1024ull, 1'000'000ull}){
+    for (double writes : {0.05, 0.5}){
+      T table(T::Config{true, 10.0, T::Policy::QUEUE, 4096});
+      Zipf keys(keyspace, 0.99);
+      std::mt19937_64 rng(9);
+      std::uniform_real_distribution<double> U(0.0, 1.0);
+      std::deque<std::pair<double, std::uint64_t>> open; // write delegates, closed 5 us in
+      std::uint64_t combined = 0;
+      auto& r = b.run("rdwc/read_write", {{"keyspace", str(keyspace)}, {"write_share", str(writes)}}, b.ops,
+        [&](std::uint64_t n){
+          double now = 0;
+          for (std::uint64_t i = 0; i < n; ++i, now += 0.05){
+            while (!open.empty() && open.front().first <= now){
+              const std::uint32_t list = table.close_write(open.front().second, [](const T::Waiter&){});
+              table.finish(list, [&](const T::Waiter&){ ++combined; });
+              open.pop_front();
+            }
+            const std::uint64_t key = keys.sample(rng);
+            if (U(rng) < writes){
+              if (table.write(key, now, now, i, nullptr) == T::Join::Delegate) open.emplace_back(now + 5.0, key);
+            } else {
+              SimTime done = 0;
+              const auto j = table.read(key, now, done);
+              if (j == T::Join::Delegate) table.read_done(key, now + 3.0);
+              else combined += j == T::Join::Combined;
+            }
+          }
+        });
+      r.extra.push_back({"combined_ratio", double(combined) / double(b.ops)});
+    }
+  }
+}
+
+void bench_llt(Bench& b){
+  for (int depth : {1, 4, 16}){
+    for (std::uint64_t keys : {1ull, 1024ull}){
+      LLT llt;
+      std::uint64_t woken = 0;
+      b.run("llt/enqueue_release", {{"waiters", str((std::uint64_t)depth)}, {"keys", str(keys)}}, b.ops,
+        [&](std::uint64_t n){
+          std::int64_t holder = 0;
+          for (std::uint64_t i = 0; i < n; i += 2 * depth){
+            const std::uint64_t key = i % keys;
+            const std::int64_t first = holder;
+            for (int d = 0; d < depth; ++d) llt.enqueue(key, holder++, [&woken](bool){ ++woken; });
+            for (int d = 0; d < depth; ++d){
+              auto next = llt.release(key, first + d, d % 2 == 0);
+              if (next.wake) next.wake(false);
+            }
+          }
+        });
+      do_not_optimize(woken);
+    }
+  }
+}
+
+void write_json(std::FILE* f, const Bench& b, const std::string& label){
+  std::fprintf(f, "{\n  \"label\": \"%s\",\n  \"ops_per_case\": %llu,\n  \"results\": [", label.c_str(), (unsigned long long)b.ops);
+  for (std::size_t i = 0; i < b.results.size(); ++i){
+    const Result& r = b.results[i];
+    std::fprintf(f, "%s\n    {\"name\": \"%s\", \"params\": {", i ? "," : "", r.name.c_str());
+    for (std::size_t p = 0; p < r.params.size(); ++p)
+      std::fprintf(f, "%s\"%s\": \"%s\"", p ? ", " : "", r.params[p].first.c_str(), r.params[p].second.c_str());
+    std::fprintf(f, "}, \"ops\": %llu, \"ns_per_op\": %.3f, \"ops_per_s\": %.0f",
+                 (unsigned long long)r.ops, r.secs * 1e9 / double(r.ops), double(r.ops) / r.secs);
+    for (const auto& [k, v] : r.extra) std::fprintf(f, ", \"%s\": %.6g", k.c_str(), v);
+    std::fprintf(f, "}");
+  }
+  std::fprintf(f, "\n  ]\n}\n");
+}
+
+} // namespace
+
+int main(int argc, char** argv){
+  Bench b;
+  std::string label, json;
+  for (int i = 1; i < argc; ++i){
+    const std::string a = argv[i];
+    const char* v = i + 1 < argc ? argv[i + 1] : nullptr;
+    if (a == "--ops" && v){ b.ops = std::strtoull(v, nullptr, 10); ++i; }
+    else if (a == "--filter" && v){ b.filter = v; ++i; }
+    else if (a == "--label" && v){ label = v; ++i; }
+    else if (a == "--json" && v){ json = v; ++i; }
+    else { std::fprintf(stderr, "usage: %s [--ops N] [--filter SUBSTR] [--label TEXT] [--json PATH]\n", argv[0]); return 2; }
+  }
+  if (!b.ops) b.ops = 1;
+
+  const std::pair<const char*, void (*)(Bench&)> cases[] = {
+    {"event_loop/hold", bench_event_loop}, {"node_cache/get_put", bench_node_cache},
+    {"hopscotch/insert_lookup", bench_hopscotch}, {"zipf/sample", bench_zipf},
+    {"token_bucket/acquire", bench_token_bucket}, {"rdwc/read_write", bench_rdwc},
+    {"llt/enqueue_release", bench_llt}};
+  for (auto [name, fn] : cases) if (b.wanted(name)) fn(b);
+
+  for (const Result& r : b.results){
+    std::string p;
+    for (const auto& [k, v] : r.params) p += k + "=" + v + " ";
+    std::fprintf(stderr, "%-24s %-40s %10.1f ns/op", r.name.c_str(), p.c_str(), r.secs * 1e9 / double(r.ops));
+    for (const auto& [k, v] : r.extra) std::fprintf(stderr, "  %s=%.4g", k.c_str(), v);
+    std::fprintf(stderr, "\n");
+  }
+
+  std::FILE* f = json.empty() ? stdout : std::fopen(json.c_str(), "w");
+  if (!f){ std::fprintf(stderr, "cannot write %s\n", json.c_str()); return 1; }
+  write_json(f, b, label);
+  if (f != stdout) std::fclose(f);
+  return 0;
+}
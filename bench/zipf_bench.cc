@@ -0,0 +1,96 @@
+// Zipf sampler benchmark and statistical check.
+//  1) setup time, memory and samples/second of the dense-CDF sampler vs
+//     rejection-inversion across keyspace sizes and skews;
+//  2) two-sample Kolmogorov-Smirnov test between the two samplers' rank
+//     distributions (alpha = 0.05), plus top-rank frequencies against the
+//     exact pmf.
+//
+// Usage: zipf_bench [samples]
+#include "sim/zipf.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+double secs(Clock::time_point a){ return std::chrono::duration<double>(Clock::now() - a).count(); }
+
+template<class F>
+double rate(std::uint64_t samples, F&& draw){
+  std::uint64_t acc = 0;
+  auto t0 = Clock::now();
+  for (std::uint64_t i = 0; i < samples; ++i) acc += draw();
+  double r = double(samples) / secs(t0);
+  if (acc == 42) std::printf("#");
+  return r;
+}
+
+// KS statistic between two empirical rank CDFs (sparse histograms).
+double ks_distance(const std::map<std::uint64_t, std::uint64_t>& a, std::uint64_t na,
+                   const std::map<std::uint64_t, std::uint64_t>& b, std::uint64_t nb){
+  auto ia = a.begin(), ib = b.begin();
+  double ca = 0, cb = 0, d = 0;
+  while (ia != a.end() || ib != b.end()){
+    std::uint64_t k = (ib == b.end() || (ia != a.end() && ia->first <= ib->first)) ? ia->first : ib->first;
+    if (ia != a.end() && ia->first == k){ ca += double(ia->second) / na; ++ia; }
+    if (ib != b.end() && ib->first == k){ cb += double(ib->second) / nb; ++ib; }
+    d = std::max(d, std::abs(ca - cb));
+  }
+  return d;
+}
+
+} // namespace
+
+int main(int argc, char** argv){
+  const std::uint64_t samples = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 2'000'000;
+
+  std::printf("== throughput (%llu samples)\n", (unsigned long long)samples);
+  std::printf("%12s %6s %12s %12s %14s %14s\n", "keyspace", "s", "cdf_setup_s", "cdf_MiB", "cdf_samp/s", "ri_samp/s");
+  for (std::uint64_t n : {1'000ull, 1'000'000ull, 2'000'000ull, 1'000'000'000ull}){
+    for (double s : {0.6, 0.9, 0.99, 1.2}){
+      std::mt19937_64 rng(1);
+      Zipf ri(n, s);
+      const double r_ri = rate(samples, [&]{ return ri.sample(rng); });
+      if (n > 10'000'000ull){
+        std::printf("%12llu %6.2f %12s %12s %14s %14.0f\n", (unsigned long long)n, s, "-", "-", "-", r_ri);
+        continue;
+      }
+      auto t0 = Clock::now();
+      ZipfCdf cdf(n, s);
+      const double setup = secs(t0);
+      std::uniform_real_distribution<double> U(0.0, 1.0);
+      const double r_cdf = rate(samples, [&]{ return cdf.sample(U(rng)); });
+      std::printf("%12llu %6.2f %12.4f %12.1f %14.0f %14.0f\n", (unsigned long long)n, s, setup,
+                  double(cdf.cdf.size() * sizeof(double)) / (1 << 20), r_cdf, r_ri);
+    }
+  }
+
+  std::printf("\n== statistical check: rejection-inversion vs dense CDF (two-sample KS, alpha=0.05)\n");
+  std::printf("%12s %6s %10s %10s %6s   %s\n", "keyspace", "s", "D", "D_crit", "ok", "p(rank0) ri / cdf / exact");
+  int failures = 0;
+  for (std::uint64_t n : {100ull, 10'000ull, 1'000'000ull}){
+    for (double s : {0.5, 0.9, 0.99, 1.0, 1.5}){
+      ZipfCdf cdf(n, s);
+      Zipf ri(n, s);
+      std::mt19937_64 r1(11), r2(12);
+      std::uniform_real_distribution<double> U(0.0, 1.0);
+      std::map<std::uint64_t, std::uint64_t> ha, hb;
+      for (std::uint64_t i = 0; i < samples; ++i){ ha[ri.sample(r1)]++; hb[cdf.sample(U(r2))]++; }
+      const double d = ks_distance(ha, samples, hb, samples);
+      const double crit = 1.358 * std::sqrt(2.0 / double(samples));
+      const bool ok = d <= crit;
+      failures += !ok;
+      std::printf("%12llu %6.2f %10.5f %10.5f %6s   %.4f / %.4f / %.4f\n", (unsigned long long)n, s, d, crit, ok ? "yes" : "NO",
+                  double(ha[0]) / samples, double(hb[0]) / samples, cdf.cdf[0]);
+    }
+  }
+  // scrambling must stay a bijection
+  Zipf sc(1'000'003, 0.99, true);
+  std::vector<bool> seen(sc.n, false);
+  bool bij = true;
+  for (std::uint64_t r = 0; r < sc.n; ++r){ auto k = sc.permute(r); bij &= k < sc.n && !seen[k]; if (k < sc.n) seen[k] = true; }
+  std::printf("\nscramble bijection on n=%llu: %s\n", (unsigned long long)sc.n, bij ? "yes" : "NO");
+  return (failures || !bij) ? 1 : 0;
+}
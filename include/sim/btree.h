@@ -0,0 +1,81 @@
+#pragma once
+#include "sim/parallel.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+// Shape model of a B+tree over keys [0, keyspace): which node every level of a
+// lookup touches, and how many entries each node holds. Fanout follows from
+// node size. The tree starts bulk-loaded at `fill`; its nodes are arithmetic
+// (bulk node i of level L covers keys [i*span_L, (i+1)*span_L)) until a split
+// materializes them, so memory is proportional to splits, not to keyspace.
+// Splits cut a node's key range in half, add an entry to the parent and
+// propagate up; a root split adds a level.
+//
+// Shared by every index instance of a run. With several PDES shards
+// (shards(n), n > 1) it only changes at window barriers: insert() queues the
+// entry and reports no split, and apply() (barrier step) adds the window's
+// inserts in (time, shard, call) order, running each split's follow-up on the
+// shard that inserted it. Lookups in between all see the same tree.
+class BTreeModel {
+public:
+  using NodeId = std::uint64_t; // level << 56 | per-level index
+  static constexpr NodeId kNone = ~0ull;
+  static int level_of(NodeId id){ return int(id >> 56); }
+
+  BTreeModel(std::uint64_t keyspace, std::size_t node_bytes, std::size_t internal_entry_bytes,
+             int leaf_capacity, double fill);
+
+  // Root-to-leaf path for key (nodes[0] is the root); returns the leaf.
+  NodeId path(std::uint64_t key, std::vector<NodeId>& nodes);
+
+  // Leaves holding keys [lo, lo+n), in key order (sibling-chain order).
+  void leaves_in_range(std::uint64_t lo, std::uint64_t n, std::vector<NodeId>& out);
+
+  struct Split { NodeId sibling{kNone}; int internal_splits{0}; bool new_root{false}; };
+  using SplitFn = std::function<void(const Split&)>;
+  // One more entry in leaf; splits it once occupancy reaches threshold*capacity
+  // (threshold > 1 never splits). With several shards the insert is queued
+  // (inserting shard, its time `at`) and a split goes to `later` after the barrier.
+  Split insert(NodeId leaf, double threshold, int shard = 0, double at = 0, SplitFn later = {});
+  void shards(int n){ pending.assign(n > 1 ? n : 0, {}); }
+  void apply(Pdes& pdes);
+
+  // Bumped whenever a node's contents change shape: its own split (range and
+  // sibling pointer) or a separator added to it. 0 for untouched bulk nodes.
+  std::uint32_t version(NodeId id);
+
+  int leaf_capacity() const { return leaf_cap; }
+  int fanout() const { return fan; }
+  int height();
+  std::uint64_t leaves();
+  std::uint64_t splits();
+
+private:
+  struct Node { std::uint64_t lo, hi; int entries; std::uint32_t version{0}; };
+  struct Level {
+    std::uint64_t span;      // keys per bulk node; 0 = a single node over everything
+    std::uint64_t bulk;      // bulk-loaded nodes
+    std::uint64_t next;      // next index for split-created nodes
+    std::map<std::uint64_t, std::uint64_t> fences;  // lo key -> index, split-created nodes
+    std::unordered_map<std::uint64_t, Node> nodes;  // materialized nodes
+  };
+
+  std::uint64_t keyspace;
+  int leaf_cap, fan;
+  std::uint64_t per_leaf, per_internal; // bulk-load occupancy
+  std::vector<Level> levels;            // levels[0] = leaves
+  std::uint64_t n_splits{0};
+  struct Insert { double at; NodeId leaf; double threshold; SplitFn later; };
+  std::vector<std::vector<Insert>> pending; // per shard, since the last barrier
+
+  static NodeId id_of(int level, std::uint64_t idx){ return (NodeId(level) << 56) | idx; }
+  std::uint64_t find(int level, std::uint64_t key) const;
+  Node peek(int level, std::uint64_t idx) const;
+  Node& node(int level, std::uint64_t idx);
+  bool split(int level, std::uint64_t idx, Split& out);
+  Split add(NodeId leaf, double threshold);
+};
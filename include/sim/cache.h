@@ -1,19 +1,70 @@
 #pragma once
-#include <list>
+#include "sim/types.h"
+#include <cstddef>
 #include <cstdint>
-#include <unordered_map>
-#include <functional>
+#include <memory>
+#include <vector>
 
 struct CacheKey { std::uint64_t node_id; int level; };
-struct CacheKeyHash { std::size_t operator()(CacheKey const& k) const { return std::hash<std::uint64_t>()((k.node_id<<3) ^ k.level); } };
-struct CacheKeyEq { bool operator()(CacheKey const&a, CacheKey const& b) const { return a.node_id==b.node_id && a.level==b.level; } };
-
-struct LRUCache {
-  std::size_t cap_bytes, cur_bytes{0};
-  std::list<CacheKey> lru;
-  std::unordered_map<CacheKey, std::list<CacheKey>::iterator, CacheKeyHash, CacheKeyEq> pos;
-  std::unordered_map<CacheKey, std::size_t, CacheKeyHash, CacheKeyEq> sz;
-  explicit LRUCache(std::size_t cap): cap_bytes(cap) {}
-  bool get(CacheKey k){ auto it=pos.find(k); if(it==pos.end()) return false; lru.splice(lru.begin(), lru, it->second); return true; }
-  void put(CacheKey k, std::size_t bytes){ if(pos.count(k)){ lru.splice(lru.begin(), lru, pos[k]); return; } lru.push_front(k); pos[k]=lru.begin(); sz[k]=bytes; cur_bytes+=bytes; while(cur_bytes>cap_bytes){ auto ev=lru.back(); lru.pop_back(); cur_bytes-=sz[ev]; sz.erase(ev); pos.erase(ev);} }
+
+// Replacement order over a NodeCache's entries, addressed by entry index.
+// The cache owns lookup and byte accounting; the policy tracks recency or
+// frequency and names victims.
+class CachePolicy {
+public:
+  static constexpr std::uint32_t kNone = ~0u;
+  virtual ~CachePolicy() = default;
+  virtual void access(std::uint64_t hash) { (void)hash; } // every lookup, hit or miss
+  virtual void insert(std::uint32_t e, std::uint64_t hash, std::size_t bytes) = 0;
+  virtual void hit(std::uint32_t e) = 0;
+  virtual std::uint32_t victim() = 0;   // kNone if nothing is evictable
+  virtual void erase(std::uint32_t e) = 0;
+  virtual std::size_t host_bytes() const = 0;
+};
+
+// cap_bytes sizes the policy's segments (S3-FIFO small queue, TinyLFU window);
+// cap_bytes / node_bytes sizes TinyLFU's frequency sketch.
+std::unique_ptr<CachePolicy> make_cache_policy(CachePolicyKind kind, std::size_t cap_bytes, std::size_t node_bytes);
+
+// Index-node cache of one compute node, shared by all of its threads (they
+// live on one shard, so no locking). Entries sit in a flat array found through
+// a linear-probing table of entry indices; replacement is delegated to a
+// CachePolicy. Nodes at depth < pin_levels never leave once cached.
+class NodeCache {
+public:
+  struct LevelStats { std::uint64_t hits{0}, misses{0}, entries{0}, bytes{0}; };
+
+  NodeCache(std::size_t cap_bytes, CachePolicyKind policy = CachePolicyKind::LRU, int pin_levels = 0,
+            std::size_t node_bytes = 4096);
+  // Hits/misses are counted per k.level; a hit reports the version the node
+  // was cached at.
+  bool get(CacheKey k, std::uint32_t* version = nullptr);
+  // Like get, but neither counted nor seen by the policy.
+  bool peek(CacheKey k, std::uint32_t* version = nullptr) const;
+  // Insert (or refresh, taking the new version) k, evicting policy victims past
+  // capacity; dropped if nothing evictable makes room.
+  void put(CacheKey k, std::size_t bytes, std::uint32_t version = 0);
+
+  std::size_t bytes() const { return cur_bytes; }
+  std::size_t host_bytes() const;
+  const std::vector<LevelStats>& levels() const { return stats; } // by depth, 0 = root
+
+private:
+  static constexpr std::uint32_t kNil = ~0u;
+  struct Entry { std::uint64_t node; std::int32_t level; std::uint32_t bytes, version; };
+
+  std::size_t cap_bytes, cur_bytes{0}, live{0};
+  int pin_levels;
+  std::unique_ptr<CachePolicy> policy;
+  std::vector<Entry> entries;
+  std::vector<std::uint32_t> free_slots;
+  std::vector<std::uint32_t> table;       // entry index or kNil; size is a power of two
+  std::vector<LevelStats> stats;
+
+  static std::uint64_t hash(std::uint64_t node, int level);
+  std::size_t home(std::uint64_t node, int level) const { return std::size_t(hash(node, level)) & (table.size() - 1); }
+  std::size_t find(CacheKey k) const;     // table slot holding k, or table.size()
+  void grow();
+  void evict(std::uint32_t e);
+  LevelStats& level(int l);
 };
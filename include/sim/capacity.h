@@ -0,0 +1,36 @@
+#pragma once
+#include "sim/types.h"
+#include <cstdint>
+#include <deque>
+#include <unordered_map>
+#include <vector>
+
+// Capacity over time in fixed slots. Callers reserve work at its arrival time
+// and it fills the first slots with room from there on; unlike a single "busy
+// until" frontier this stays correct when reservations come out of time order
+// (verbs are costed when posted, arrivals lie in the future by varying amounts).
+//
+// Shared by PDES shards (shards(n), n > 1), a shard fills the room each slot
+// had at the last window barrier and sees the other shards' work only after
+// the next one: commit() (barrier step, one thread) adds every shard's
+// reservations in shard order and spills whatever overbooks a slot into the
+// following ones, so the outcome no longer depends on which thread got there
+// first and the backlog is exact from the next window on.
+class SlotCalendar {
+public:
+  SlotCalendar(double slot_us, double capacity_per_us);
+  // Completion of `amount` units of work that arrives at `arrive` and needs at
+  // least `min_us` even on an idle resource.
+  SimTime reserve(SimTime arrive, double amount, double min_us, int shard = 0);
+  void shards(int n){ pending.assign(n > 1 ? n : 0, {}); }
+  void commit();
+
+private:
+  double slot_us, cap;          // cap: units per slot
+  std::int64_t base{0};         // slot index of used.front()
+  std::deque<double> used;
+  std::vector<std::unordered_map<std::int64_t, double>> pending; // per shard, since the last commit
+  static constexpr std::int64_t kKeepSlots = 1 << 16; // history kept behind the latest arrival
+
+  void prune(std::int64_t newest);
+};
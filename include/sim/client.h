@@ -0,0 +1,36 @@
+#pragma once
+#include "sim/config.h"
+#include "sim/index.h"
+#include "sim/trace.h"
+#include "sim/zipf.h"
+#include <random>
+
+// Per-thread load generator. Each client thread owns its op stream (RNG seeded
+// by global thread id, fixed op quota) and drives its Index according to the
+// workload's client model, so the op sequence is independent of sharding.
+//  - Closed: keeps `outstanding` ops in flight; next op issues think_us after a completion.
+//  - Open:   issues at its share of rate_ops_per_s (Poisson or fixed gaps),
+//            regardless of completions; overload shows up as NIC queueing.
+// With a key trace, op op_id replays trace record op_id (and, open loop, issues
+// at the record's arrival time when the trace has them).
+struct ClientThread : OpSink {
+  EventLoop& loop;
+  Index& idx;
+  Metrics& m;
+  const WorkloadCfg& wl;
+  const Zipf& zipf;
+  const trace::Reader* trace;
+  int gid, nthreads;
+  std::uint64_t quota, issued{0};
+  std::mt19937_64 rng;
+  std::uniform_real_distribution<double> U{0.0, 1.0};
+
+  ClientThread(EventLoop& l, Index& i, Metrics& mm, const WorkloadCfg& w, const Zipf& z, int g, int n,
+               const trace::Reader* t = nullptr);
+  void start();
+  void op_done(std::uint64_t op_id, SimTime when) override;
+
+private:
+  void issue();
+  void schedule_arrival();
+};
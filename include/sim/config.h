@@ -1,10 +1,27 @@
 #pragma once
+#include "sim/types.h"
 #include <cstddef>
 #include <cstdint>
 #include <string>
 #include <vector>
 
-struct Mix { double read{1.0}, write{0.0}; };
+// Op mix; whatever is not read or scan is write. One uniform draw picks the op.
+struct Mix {
+  double read{1.0}, write{0.0}, scan{0.0};
+  OpType pick(double u) const { return u < read ? OpType::Get : u < read + scan ? OpType::Scan : OpType::Put; }
+};
+
+// Load generation model (see client.h). Batch is the legacy mode: every op
+// is injected at t=0, round-robin over threads.
+enum class ClientMode { Batch, Closed, Open };
+enum class Arrival { Poisson, Fixed };
+struct ClientCfg {
+  ClientMode mode{ClientMode::Closed};
+  int outstanding{1};          // closed: ops in flight per thread
+  double think_us{0.0};        // closed: delay from completion to next issue
+  Arrival arrival{Arrival::Poisson};
+  double rate_ops_per_s{1e6};  // open: offered load summed over all threads
+};
 
 struct WorkloadCfg {
   std::string name;
@@ -12,7 +29,13 @@ struct WorkloadCfg {
   Mix mix;
   std::uint64_t keyspace{0};
   double zipf{0.0};
-  std::uint32_t range_len{1};
+  bool scramble_keys{false};   // spread hot ranks over the keyspace
+  ZipfSampler zipf_sampler{ZipfSampler::RejectionInversion};
+  std::uint32_t range_len{1};  // keys per scan
+  ClientCfg client;
+  // Replay this key trace (sim/trace.h) instead of mix + zipf: record i is op_id i.
+  // ops 0 replays all of it; keys are taken modulo keyspace (0: trace max key + 1).
+  std::string trace;
 };
 
 struct NicCaps {
@@ -37,6 +60,12 @@ struct NicCaps {
   double pcie_desc_us{0.03};
   int doorbell_batch_limit{16};
   int sq_depth{512};
+
+  // Per-node port: message-engine rate shared by all QPs of a node, for the
+  // verbs it issues and the ones it serves (link_gbps is the port's line rate)
+  double port_read_ops_per_s{100e6};
+  double port_write_ops_per_s{100e6};
+  double port_cas_ops_per_s{50e6};
 };
 
 struct ClusterConf {
@@ -47,9 +76,16 @@ struct ClusterConf {
   int ms_cpu_cores{2};
 };
 
-struct MemoryConf { std::size_t onchip_bytes{256*1024}; double dram_lat_us{0.6}; };
+// Memory server (YAML `memory_server`): RNIC on-chip memory for lock words, DRAM latency/bandwidth.
+struct MemoryConf {
+  std::size_t onchip_bytes{256*1024};
+  double dram_lat_us{0.6};
+  double dram_bw_gbps{800};   // DRAM channel bandwidth seen by remote accesses
+  std::size_t lock_bytes{2};  // one GLT lock word (masked CAS); glt_slots*lock_bytes beyond onchip_bytes spill to DRAM
+};
 
 enum class IndexKind { Sherman, DEX };
+inline std::string index_name(IndexKind k){ return k == IndexKind::DEX ? "DEX" : "Sherman"; }
 
 struct ShermanConf {
   bool combine{true};
@@ -57,17 +93,22 @@ struct ShermanConf {
     bool enable{true};
     int glt_slots{131072};
     bool llt_enable{true};
-    // Local queueing cost per position in LLT (purely local, no NIC). Keep small but non-zero to model fairness handoff.
+    // Consecutive LLT hand-overs of a leaf's global lock before it is released
+    // on the wire (0 = never hand over)
+    int handover_depth{4};
+    // Local wake-up latency when the LLT passes the leaf to the next waiter (purely local, no NIC).
     double llt_local_wait_us{0.0};
   } hocl;
   bool two_level_versioning{true};
-  int cache_levels{2};
+  int cache_levels{2};   // tree depths pinned in the compute node's cache
+  CachePolicyKind cache_policy{CachePolicyKind::LRU}; // replacement below the pinned depths
 
   // RDWC (Read/Write Delegation with Coalescing) - SMART-style
   struct rdwc_t {
     bool enable{false};
     double window_us{100.0}; // delegation window in microseconds
     enum CollisionPolicy { BYPASS = 0, QUEUE = 1 } collision_policy{QUEUE};
+    int slots{4096}; // delegation slots per compute node (direct-mapped by key)
   } rdwc;
 
   // Hopscotch hash overlay (CHIME-style) - accelerated leaf lookups
@@ -77,12 +118,12 @@ struct ShermanConf {
     int slots_per_leaf{32}; // hash table size per leaf overlay
     bool enable_speculative{true}; // speculative lookups without leaf lock
     int topK{8}; // only build overlays for top K hottest leaves
-    double rebuild_threshold{0.7}; // rebuild when utilization exceeds this
+    std::size_t budget_bytes{1 << 20}; // overlay memory per compute node (caps topK)
+    double rebuild_threshold{0.7}; // clear when an insert fails above this utilization
   } hopscotch;
 
   // Advanced fidelity
   unsigned int glt_hash_seed{0x9e3779b9};
-  int cas_max_retries{16};
   double cas_backoff_us{0.5};
   bool model_glt_collisions{true};
 
@@ -105,6 +146,9 @@ struct DexConf {
   int repartition_topK{8};
   double remap_broadcast_us{100.0};
   double cache_inval_prob{0.25};
+
+  int cache_levels{0};   // as ShermanConf
+  CachePolicyKind cache_policy{CachePolicyKind::LRU};
 };
 
 // Ablations (paper-style toggles)
@@ -116,14 +160,32 @@ struct IndexConf {
   IndexKind kind{IndexKind::Sherman};
   std::size_t node_bytes{4096};
   std::size_t leaf_entry_bytes{24};
+  std::size_t internal_entry_bytes{16}; // separator key + child pointer; fanout = node_bytes / this
+  double bulk_fill{0.8};                // initial node occupancy of the bulk-loaded tree
   ShermanConf sh;
   DexConf dx;
   Ablations ablations;
 };
 
-struct MetricsCfg { std::vector<int> ptiles{50,95,99}; bool dump_per_op_trace{true}; std::string out_dir{"out"}; };
+struct MetricsCfg {
+  std::vector<double> ptiles{50,95,99};
+  bool dump_per_op_trace{true};
+  // per-op trace: keep 1 in N ops, or a uniform reservoir of this many (>0 wins); zlib chunks
+  std::uint64_t op_trace_sample_every{1}, op_trace_reservoir{0};
+  bool op_trace_compress{true};
+  double window_us{0}; // >0: per-workload timeseries_*.csv with one row per window of sim time
+  std::string out_dir{"out"};
+};
+
+// Simulator engine (host-side execution, not modeled hardware)
+struct EngineConf {
+  EventQueueKind event_queue{EventQueueKind::Calendar};
+  int workers{1};            // PDES shards; compute nodes are split into contiguous blocks
+  double lookahead_us{-1};   // <=0: derive from the NIC's minimum latency
+};
 
 struct SimConf {
+  EngineConf engine;
   ClusterConf cluster;
   NicCaps nic;
   MemoryConf mem;
@@ -132,4 +194,12 @@ struct SimConf {
   MetricsCfg metrics;
 };
 
-SimConf LoadConfig(const std::string& path);
\ No newline at end of file
+SimConf LoadConfig(const std::string& path);
+
+// A named configuration; sweeps expand into one Scenario per grid point.
+struct Scenario { std::string name; SimConf conf; };
+
+// Sweep spec: `base: <config.yaml>` (relative to the spec) plus a `sweep:` map of
+// dotted YAML keys to value lists, e.g. `sherman.hocl.enable: [true, false]`.
+// Expands to the cartesian product; names are "<spec>:<key>=<val>:...".
+std::vector<Scenario> LoadSweep(const std::string& path);
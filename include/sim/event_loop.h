@@ -1,17 +1,140 @@
 #pragma once
-#include <queue>
-#include <functional>
+#include "sim/types.h"
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
-struct Event {
-  double t;
-  std::function<void()> fn;
-  bool operator<(const Event& other) const { return t > other.t; } // min-heap
+// Move-only type-erased callable with inline storage. Closures up to kInline
+// bytes (every callback the simulator schedules) live inside the event record;
+// larger ones fall back to a heap box.
+class EventFn {
+public:
+  static constexpr std::size_t kInline = 96;
+
+  EventFn() = default;
+  template<class F, class D = std::decay_t<F>, class = std::enable_if_t<!std::is_same_v<D, EventFn>>>
+  EventFn(F&& f){
+    if constexpr (sizeof(D) <= kInline && alignof(D) <= alignof(std::max_align_t) && std::is_nothrow_move_constructible_v<D>){
+      ::new (static_cast<void*>(buf)) D(std::forward<F>(f)); ops = &inline_ops<D>;
+    } else {
+      *reinterpret_cast<D**>(buf) = new D(std::forward<F>(f)); ops = &boxed_ops<D>;
+    }
+  }
+  EventFn(EventFn&& o) noexcept : ops(o.ops) { if (ops){ ops->move(buf, o.buf); o.ops = nullptr; } }
+  EventFn& operator=(EventFn&& o) noexcept {
+    if (this != &o){ reset(); ops = o.ops; if (ops){ ops->move(buf, o.buf); o.ops = nullptr; } }
+    return *this;
+  }
+  EventFn(const EventFn&) = delete;
+  EventFn& operator=(const EventFn&) = delete;
+  ~EventFn(){ reset(); }
+
+  void operator()(){ ops->call(buf); }
+  explicit operator bool() const { return ops != nullptr; }
+  void reset(){ if (ops){ ops->destroy(buf); ops = nullptr; } }
+
+private:
+  struct Ops { void (*call)(void*); void (*move)(void* dst, void* src); void (*destroy)(void*); };
+  template<class D> static constexpr Ops inline_ops{
+    [](void* p){ (*static_cast<D*>(p))(); },
+    [](void* d, void* s){ ::new (d) D(std::move(*static_cast<D*>(s))); static_cast<D*>(s)->~D(); },
+    [](void* p){ static_cast<D*>(p)->~D(); }
+  };
+  template<class D> static constexpr Ops boxed_ops{
+    [](void* p){ (**static_cast<D**>(p))(); },
+    [](void* d, void* s){ *static_cast<D**>(d) = *static_cast<D**>(s); },
+    [](void* p){ delete *static_cast<D**>(p); }
+  };
+  const Ops* ops{nullptr};
+  alignas(std::max_align_t) unsigned char buf[kInline];
+};
+
+// Binary min-heap with the exact push/pop sequence of the original
+// std::priority_queue<Event>, so runs on it reproduce legacy tie ordering.
+class HeapQueue {
+public:
+  void push(SimTime t, EventFn&& fn);
+  bool pop(SimTime& t, EventFn& fn);
+  bool peek(SimTime& t) const { if (heap.empty()) return false; t = heap.front().t; return true; }
+  std::size_t size() const { return heap.size(); }
+  void clear(){ heap.clear(); }
+private:
+  struct Item { SimTime t; EventFn fn; };
+  std::vector<Item> heap;
+};
+
+// Calendar queue (Brown, CACM 1988). Events live in a recycled node pool and
+// are chained into per-bucket lists ordered by (time, insertion seq), so equal
+// timestamps pop FIFO. Bucket count tracks the population; width is re-estimated
+// from the earliest pending events on every resize.
+class CalendarQueue {
+public:
+  CalendarQueue();
+  void push(SimTime t, EventFn&& fn);
+  bool pop(SimTime& t, EventFn& fn);
+  bool peek(SimTime& t);
+  std::size_t size() const { return count; }
+  void clear();
+private:
+  static constexpr std::uint32_t kNil = 0xffffffffu;
+  static constexpr std::size_t kMinBuckets = 2;
+  struct Node { SimTime t{0}; std::uint64_t seq{0}; std::uint32_t next{kNil}; EventFn fn; };
+
+  // Node pool in fixed-size chunks (stable addresses); freed nodes are recycled
+  // through free_head, so steady-state push/pop never allocates.
+  static constexpr std::uint32_t kChunkBits = 10;
+  std::vector<std::unique_ptr<Node[]>> chunks;
+  std::uint32_t pool_size{0};
+  std::uint32_t free_head{kNil};
+  Node& node(std::uint32_t i){ return chunks[i >> kChunkBits][i & ((1u << kChunkBits) - 1)]; }
+  const Node& node(std::uint32_t i) const { return chunks[i >> kChunkBits][i & ((1u << kChunkBits) - 1)]; }
+
+  std::vector<std::uint32_t> head, tail;
+  std::vector<SimTime> scratch;    // resize-time sampling buffer
+  double width{1.0};
+  std::size_t last_bucket{0};
+  std::uint64_t cur_slot{0};       // calendar day being scanned (floor(t / width))
+  SimTime last_prio{0.0};
+  std::size_t count{0};
+  std::uint64_t next_seq{0};
+
+  std::uint64_t slot_of(SimTime t) const { return static_cast<std::uint64_t>(t / width); }
+  std::size_t bucket_of(SimTime t) const { return static_cast<std::size_t>(slot_of(t) % head.size()); }
+  bool earlier(const Node& a, const Node& b) const { return a.t < b.t || (a.t == b.t && a.seq < b.seq); }
+  void link(std::uint32_t i);
+  std::uint32_t find_min();
+  void resize(std::size_t nb);
+  double estimate_width();
 };
 
 struct EventLoop {
-  double now{0.0};
-  std::priority_queue<Event> pq;
-  void at(double t, std::function<void()> fn) { pq.push(Event{t, std::move(fn)}); }
-  void after(double dt, std::function<void()> fn) { at(now + dt, std::move(fn)); }
-  void run() { while (!pq.empty()) { auto e = pq.top(); pq.pop(); now = e.t; e.fn(); } }
+  SimTime now{0.0};
+  EventQueueKind kind{EventQueueKind::Calendar};
+  std::uint64_t executed{0};
+  // Optional: on_tick runs before the first event at or after tick_at, and is
+  // expected to move tick_at forward (metrics windows).
+  SimTime tick_at{std::numeric_limits<SimTime>::infinity()};
+  EventFn on_tick;
+
+  explicit EventLoop(EventQueueKind k = EventQueueKind::Calendar) : kind(k) {}
+
+  template<class F> void at(SimTime t, F&& fn){
+    if (kind == EventQueueKind::Heap) heap.push(t, EventFn(std::forward<F>(fn)));
+    else cal.push(t, EventFn(std::forward<F>(fn)));
+  }
+  template<class F> void after(SimTime dt, F&& fn){ at(now + dt, std::forward<F>(fn)); }
+  void run();
+  // Execute events with t < horizon; later events stay queued.
+  void run_until(SimTime horizon);
+  bool next_time(SimTime& t){ return kind == EventQueueKind::Heap ? heap.peek(t) : cal.peek(t); }
+  std::size_t pending() const { return kind == EventQueueKind::Heap ? heap.size() : cal.size(); }
+
+private:
+  HeapQueue heap;
+  CalendarQueue cal;
 };
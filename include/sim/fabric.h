@@ -0,0 +1,43 @@
+#pragma once
+#include "sim/capacity.h"
+#include "sim/config.h"
+#include "sim/types.h"
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+// One node's RNIC port: a full-duplex link (each direction serializes the
+// bytes it carries) and one message engine shared by every QP of the node
+// (per-verb op rate caps, requester and responder work alike). Shared by all
+// shards: `shard` is the caller's, and with several shards reservations are
+// folded together at window barriers (see SlotCalendar).
+class Port {
+public:
+  Port(double link_gbps, double read_ops_per_s, double write_ops_per_s, double cas_ops_per_s);
+  SimTime op(SimTime t, Verb v, int shard = 0);              // message engine
+  SimTime tx(SimTime t, std::size_t bytes, int shard = 0);   // outbound link
+  SimTime rx(SimTime t, std::size_t bytes, int shard = 0);   // inbound link
+  void shards(int n){ engine.shards(n); out.shards(n); in.shards(n); }
+  void commit(){ engine.commit(); out.commit(); in.commit(); }
+  std::atomic<std::uint64_t> ops{0}, tx_bytes{0}, rx_bytes{0};
+  double bytes_per_us;
+
+private:
+  double us_per_read, us_per_write, us_per_cas;
+  SlotCalendar engine, out, in;
+};
+
+// Ports of every compute and memory node of a run.
+struct Fabric {
+  std::vector<std::unique_ptr<Port>> cs, ms;
+  Fabric(const NicCaps& caps, int compute_nodes, int memory_nodes);
+  Port& cs_port(int id){ return *cs[id % cs.size()]; }
+  Port& ms_port(int id){ return *ms[id % ms.size()]; }
+  void shards(int n){ for (auto& p : cs) p->shards(n); for (auto& p : ms) p->shards(n); }
+  void commit(){ for (auto& p : cs) p->commit(); for (auto& p : ms) p->commit(); }
+  // Busiest direction's share of link capacity over span_us, max over all ports.
+  double max_util(SimTime span_us) const;
+  // One row per port: node kind/id, ops, bytes and utilization per direction.
+  void write_util(const std::string& path, SimTime span_us) const;
+};
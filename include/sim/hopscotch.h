@@ -1,87 +1,85 @@
 #pragma once
+#include <cstddef>
 #include <cstdint>
+#include <unordered_map>
 #include <vector>
-#include <array>
 
 namespace hopscotch {
 
-// Hopscotch hash overlay for B+ tree leaves (CHIME-style)
-// Each leaf gets a small hopscotch table to accelerate key lookups
-// before falling back to full leaf scan
+// Hopscotch hash overlay for B+ tree leaves (CHIME-style): the compute node's
+// picture of where keys sit in a hopscotch-organized leaf. Every key lives
+// within H slots of its home slot, so a lookup needs at most the neighborhood
+// of H entries; a remembered slot (hint) needs a single entry.
+// Insert displaces entries toward their home to make room; a displacement
+// bumps the layout version, which makes the hints learnt before it stale.
 class HopscotchOverlay {
 public:
   static constexpr int DEFAULT_H = 16;  // neighborhood size
   static constexpr int DEFAULT_SLOTS = 32; // slots per leaf overlay
-  
+
   struct Entry {
     std::uint64_t key{0};
+    std::uint32_t seen{0};      // layout version the slot was learnt at
     std::uint16_t leaf_slot{0}; // position in the actual B+ leaf
     bool valid{false};
-    
-    Entry() = default;
-    Entry(std::uint64_t k, std::uint16_t slot) : key(k), leaf_slot(slot), valid(true) {}
   };
-  
-private:
-  int H_; // neighborhood size 
-  int num_slots_;
-  std::vector<std::uint64_t> bitmap_; // neighborhood bitmaps (one per slot)
-  std::vector<Entry> slots_; // the hash table slots
-  
-  // Hash function for keys within this overlay
-  std::uint32_t hash_key(std::uint64_t key) const {
-    // Simple hash - in practice could use the same hash as B+ tree
-    return static_cast<std::uint32_t>((key * 0x9e3779b9) >> (32 - 5)); // log2(32) = 5
-  }
-  
-public:
-  HopscotchOverlay(int H = DEFAULT_H, int slots = DEFAULT_SLOTS) 
-    : H_(H), num_slots_(slots), bitmap_(slots, 0), slots_(slots) {}
-  
-  // Insert a key->leaf_slot mapping into the hopscotch table
-  // Returns true if successfully inserted, false if table full
+
+  HopscotchOverlay(int H = DEFAULT_H, int slots = DEFAULT_SLOTS);
+
+  // Insert (or update) key -> leaf_slot; false if no slot within H of home can be freed.
   bool insert(std::uint64_t key, std::uint16_t leaf_slot);
-  
-  // Lookup a key in the hopscotch table
-  // Returns leaf_slot if found, -1 if not found
-  // If found, this gives the position in the actual B+ leaf to check
+  // Overlay slot holding key, or -1.
   int lookup(std::uint64_t key) const;
-  
-  // Remove a key from the hopscotch table
   void remove(std::uint64_t key);
-  
-  // Clear the entire overlay (e.g., when leaf splits/merges)
   void clear();
-  
-  // Get utilization stats for debugging/metrics
-  double utilization() const;
-  int num_entries() const;
-  
-  // Configuration getters
+
+  const Entry& at(int pos) const { return slots_[pos]; }
+  // Is the hint at pos still where the leaf has the key (no displacement since)?
+  bool fresh(int pos) const { return slots_[pos].seen == layout_; }
+  void refresh(int pos){ slots_[pos].seen = layout_; }
+
+  double utilization() const { return double(count_) / num_slots_; }
+  int num_entries() const { return count_; }
   int neighborhood_size() const { return H_; }
   int slot_count() const { return num_slots_; }
-  
+  std::size_t bytes() const { return slots_.size() * sizeof(Entry) + bitmap_.size() * sizeof(std::uint64_t); }
+
 private:
-  // Find an empty slot within neighborhood H of home bucket
-  int find_empty_slot(int home) const;
-  
-  // Try to move entries to make space closer to home
-  bool displace_closer(int empty_slot, int home);
-  
-  // Set/clear bit in neighborhood bitmap
-  void set_bitmap_bit(int home, int slot);
-  void clear_bitmap_bit(int home, int slot);
-  bool get_bitmap_bit(int home, int slot) const;
+  int H_; // neighborhood size (<= 64, one bitmap word per home)
+  int num_slots_;
+  int count_{0};
+  std::uint32_t layout_{0};
+  std::vector<std::uint64_t> bitmap_; // per home slot: bit i = slot home+i holds one of its keys
+  std::vector<Entry> slots_;
+
+  int home_of(std::uint64_t key) const;
+  int dist(int home, int slot) const { return (slot - home + num_slots_) % num_slots_; }
 };
 
-// Configuration for hopscotch overlays
-struct HopscotchConf {
-  bool enable{false};
-  int H{HopscotchOverlay::DEFAULT_H}; // neighborhood size
-  int slots_per_leaf{HopscotchOverlay::DEFAULT_SLOTS}; // hash table size per leaf
-  bool enable_speculative{true}; // speculative lookups without waiting for leaf lock
-  int topK{8}; // only build overlays for top K hottest leaves
-  double rebuild_threshold{0.7}; // rebuild overlay when utilization exceeds this
+// Overlays of one compute node, shared by its threads: only the topK hottest
+// leaves (access counts, halved periodically) get one, and no more than
+// budget_bytes worth of them. A hotter leaf takes the coldest one's overlay.
+class OverlaySet {
+public:
+  struct Conf { bool enable{false}; int H{16}, slots{32}, topK{8}; std::size_t budget_bytes{1 << 20}; };
+  explicit OverlaySet(const Conf& c);
+
+  // Count an access to leaf; its overlay if it is (now) among the hottest.
+  HopscotchOverlay* touch(std::uint64_t leaf);
+  HopscotchOverlay* find(std::uint64_t leaf);
+  std::size_t capacity() const { return cap; }
+  std::size_t bytes() const;
+
+private:
+  static constexpr std::uint64_t kAgeEvery = 1 << 16;
+  Conf conf;
+  std::size_t cap;
+  std::uint64_t accesses{0}, min_heat{0}; // min_heat: lower bound on the coldest overlaid leaf
+  std::unordered_map<std::uint64_t, std::uint64_t> heat;
+  std::unordered_map<std::uint64_t, HopscotchOverlay> overlays;
+
+  void age();
+  std::uint64_t coldest(std::uint64_t& leaf) const;
 };
 
-} // namespace hopscotch
\ No newline at end of file
+} // namespace hopscotch
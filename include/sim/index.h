@@ -1,4 +1,5 @@
 #pragma once
+#include "sim/btree.h"
 #include "sim/event_loop.h"
 #include "sim/rdma.h"
 #include "sim/cache.h"
@@ -6,11 +7,16 @@
 #include <memory>
 #include <vector>
 
-struct IndexCtx { EventLoop* loop{nullptr}; NIC* nic{nullptr}; int cs_id{0}, ms_id{0}; int qp{0}; std::size_t node_bytes{4096}, leaf_entry_bytes{24}; };
+// Completion hook for whoever issued the op (the client model).
+struct OpSink { virtual ~OpSink() = default; virtual void op_done(std::uint64_t op_id, SimTime when) = 0; };
+
+struct IndexCtx { EventLoop* loop{nullptr}; NIC* nic{nullptr}; int cs_id{0}, ms_id{0}; int qp{0}; std::size_t node_bytes{4096}, leaf_entry_bytes{24}; OpSink* sink{nullptr}; BTreeModel* tree{nullptr}; };
 
 struct Index {
   IndexCtx ctx;
   virtual ~Index() = default;
   virtual void get(std::uint64_t key, Metrics& m, std::uint64_t op_id) = 0;
   virtual void put(std::uint64_t key, Metrics& m, std::uint64_t op_id) = 0;
+  // Read the len keys starting at start_key (clipped to the keyspace).
+  virtual void scan(std::uint64_t start_key, std::uint32_t len, Metrics& m, std::uint64_t op_id) = 0;
 };
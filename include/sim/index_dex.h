@@ -0,0 +1,89 @@
+#pragma once
+#include "sim/index.h"
+#include "sim/cache.h"
+#include "sim/config.h"
+#include "sim/metrics.h"
+#include "sim/parallel.h"
+#include "sim/rdma.h"
+#include <atomic>
+#include <random>
+#include <vector>
+
+struct Dex;
+
+// State the DEX instances of one run share: the logical partition map (range
+// partitions of the keyspace -> owning compute node), partition heat for
+// repartitioning, per-memory-server offload budgets, and where each compute
+// node lives (shard, loop, metrics, server instances) for forwarding.
+// With several shards the map and budgets only change at window barriers:
+// shards count heat and spend tokens on their own slots against the state
+// committed at the last barrier, and commit() folds them in shard order.
+struct DexCluster {
+  struct ComputeNode { int shard{0}; Metrics* metrics{nullptr}; std::vector<Dex*> servers; };
+
+  DexConf conf;
+  std::uint64_t keyspace;
+  Pdes& pdes;
+  std::vector<ComputeNode> cs;
+
+  DexCluster(const DexConf& c, int compute_nodes, int memory_nodes, int ms_cpu_cores,
+             std::uint64_t keyspace, Pdes& p);
+
+  int partition_of(std::uint64_t key) const;
+  // Owner of key's partition and the time it can serve it (after an in-flight
+  // remap). Counts heat and runs the periodic repartition when it is due.
+  int route(std::uint64_t key, SimTime now, SimTime& ready, int shard=0);
+  std::uint32_t epoch(int part) const { return epochs[part]; }
+  // Take one op of MS CPU budget if it is available right now.
+  bool try_offload(int ms, SimTime now, int shard=0);
+
+  // Defer updates for n > 1 shards; commit() runs at each barrier, with the
+  // end of the window just run (a repartition due by then happens there).
+  void shards(int n);
+  void commit(SimTime t_end);
+
+  std::atomic<std::uint64_t> forwarded{0}, offloaded{0}, remaps{0};
+
+private:
+  std::vector<int> owner;
+  std::vector<std::uint64_t> heat;
+  std::vector<std::vector<std::uint64_t>> shard_heat; // [shard][part], deferred mode only
+  std::vector<std::vector<double>> spent;             // [shard][ms] tokens taken this window
+  std::vector<SimTime> frozen_until;
+  std::vector<std::uint32_t> epochs;
+  std::vector<TokenBucket> ms_cpu;
+  SimTime next_repartition;
+  void repartition(SimTime now);
+};
+
+// DEX-style index: logical partitioning (each key range is served by one
+// compute node; others forward to it over two-sided messages), a path-aware
+// cache of internal nodes (admitted top-down, leaves always remote), and
+// offloading of cache-missing traversals to the memory server's CPU when its
+// budget allows. Owners write without remote locks.
+struct Dex : public Index {
+  DexConf conf;          // by value (allows ablated copy)
+  NodeCache& cache;      // shared by the compute node's threads
+  DexCluster& cl;
+
+  Dex(const IndexCtx& c, DexConf dc, NodeCache& cache, DexCluster& cluster);
+  void get(std::uint64_t key, Metrics& m, std::uint64_t op_id) override;
+  void put(std::uint64_t key, Metrics& m, std::uint64_t op_id) override;
+  void scan(std::uint64_t start_key, std::uint32_t len, Metrics& m, std::uint64_t op_id) override;
+
+private:
+  struct Cost { std::uint64_t reads{0}, writes{0}, cas{0}, sends{0}, recvs{0}, br{0}, bw{0}; LatBreakdown path; };
+  std::vector<std::uint32_t> seen_epoch;
+  std::mt19937_64 rng;
+  std::uniform_real_distribution<double> U{0.0, 1.0};
+
+  void dispatch(OpType op, std::uint64_t key, std::uint32_t len, Metrics& m, std::uint64_t op_id);
+  // Runs the op on this (owning) node; verbs are posted now, returns completion.
+  SimTime execute(OpType op, std::uint64_t key, std::uint32_t len, Metrics& m, Cost& cost);
+  // Internal levels of the root-to-leaf path; false if the rest of the lookup was offloaded.
+  bool traverse(const std::vector<std::uint64_t>& nodes, std::uint64_t key, bool may_offload,
+                Metrics& m, Cost& cost, SimTime& done);
+  SimTime post(const RdmaReq& r, Metrics& m, Cost& cost);
+  SimTime write_split(const BTreeModel::Split& split, Metrics& m, Cost& cost);
+  void finish(OpType op, SimTime start, SimTime done, const Cost& cost, Metrics& m, std::uint64_t op_id);
+};
@@ -6,47 +6,73 @@
 #include "sim/config.h"
 #include "sim/rdwc.h"
 #include "sim/hopscotch.h"
+#include <memory>
 #include <unordered_map>
 
 struct Sherman : public Index {
   ShermanConf conf;      // store by value (allows ablated copy)
-  GLT glt;
-  LLT llt;
-  LRUCache cache;
-  rdwc::DelegationTable delegation_table; // RDWC delegation
+  LockTables& locks;     // shared with every compute node of the run
+  LLT& llt;              // this compute node's
+  NodeCache& cache;      // shared by the compute node's threads
+  rdwc::DelegationTable& rdwc; // RDWC, shared by the compute node's threads
+  hopscotch::OverlaySet& hop;  // leaf overlays, shared by the compute node's threads
 
-  // Leaf occupancy & versions
+  // Leaf versions (occupancy lives in the shared tree model, ctx.tree)
   struct LeafMeta { 
-    int entries{0}; 
     std::uint64_t node_ver{0}; 
     std::vector<std::uint64_t> entry_ver; 
-    // Hopscotch overlay for accelerated lookups
-    std::unique_ptr<hopscotch::HopscotchOverlay> overlay{nullptr};
-    std::uint64_t access_count{0}; // for topK tracking
   };
   std::unordered_map<std::uint64_t, LeafMeta> leafs; // leaf_id -> meta
 
-  Sherman(const IndexCtx& c, ShermanConf sc, std::size_t cache_bytes);
+  Sherman(const IndexCtx& c, ShermanConf sc, NodeCache& cache, LockTables& locks, rdwc::DelegationTable& rdwc,
+          hopscotch::OverlaySet& hop);
   void get(std::uint64_t key, Metrics& m, std::uint64_t op_id) override;
   void put(std::uint64_t key, Metrics& m, std::uint64_t op_id) override;
+  void scan(std::uint64_t start_key, std::uint32_t len, Metrics& m, std::uint64_t op_id) override;
 private:
+  // Verb counts of one op. Each step of an op runs synchronously inside one
+  // event, so the shard counters' delta over a step is the op's own.
+  struct OpCost {
+    std::uint64_t reads{0}, writes{0}, cas{0}, br{0}, bw{0};
+    static OpCost of(const Metrics& m){ return {m.remote_reads, m.remote_writes, m.remote_cas, m.bytes_read, m.bytes_write}; }
+    OpCost operator-(const OpCost& o) const { return {reads-o.reads, writes-o.writes, cas-o.cas, br-o.br, bw-o.bw}; }
+    OpCost& operator+=(const OpCost& o){ reads+=o.reads; writes+=o.writes; cas+=o.cas; br+=o.br; bw+=o.bw; return *this; }
+  };
+  // A write in flight across its lock events.
+  struct PutOp {
+    std::uint64_t key{0}, leaf{0}, op_id{0};
+    std::int64_t holder{-1};   // lock owner id
+    SimTime start{0}, lock_start{0};
+    int cas{0};                // CAS posted for the lock
+    std::uint32_t combined{rdwc::DelegationTable::kNil}; // RDWC writes riding on this one
+    OpCost cost;
+    LatBreakdown path;         // critical path so far, phase by phase
+  };
+
   std::uint64_t path_to_leaf(std::uint64_t key, std::vector<std::uint64_t>& nodes);
-  void read_node(std::uint64_t node_id, int level, Metrics& m, SimTime& completion);
-  void hocl_acquire(std::uint64_t leaf, int tid, Metrics& m, SimTime& completion);
-  void hocl_release(std::uint64_t leaf, int tid, Metrics& m, SimTime& completion);
-  void hocl_release_state_at(std::uint64_t leaf, int tid, SimTime when);
+  bool read_node(std::uint64_t node_id, int level, Metrics& m, SimTime& completion); // true: cached copy was stale
+  void read_path(const std::vector<std::uint64_t>& nodes, int depth, Metrics& m, SimTime& completion);
+  void hocl_acquire(std::shared_ptr<PutOp> op, Metrics& m);
+  void cas_attempt(std::shared_ptr<PutOp> op, Metrics& m);
+  void write_locked(std::shared_ptr<PutOp> op, Metrics& m);
+  SimTime split_leaf(std::uint64_t leaf, const BTreeModel::Split& split, Metrics& m);
+  void hocl_release(std::uint64_t leaf, std::int64_t holder, Metrics& m, SimTime& completion);
+  void hocl_release_state_at(std::uint64_t leaf, std::int64_t holder, SimTime when, bool handover, Metrics& m);
 
-  // RDWC internal methods
-  void delegate_get_impl(std::uint64_t key, Metrics& m, std::uint64_t op_id);
-  void delegate_put_impl(std::uint64_t key, Metrics& m, std::uint64_t op_id);
+  // RDWC front ends (start: when the op was issued, kept across retries) and the
+  // ops themselves; delegate_get_impl returns its completion time.
+  void get_at(std::uint64_t key, Metrics& m, std::uint64_t op_id, SimTime start);
+  void put_at(std::uint64_t key, Metrics& m, std::uint64_t op_id, SimTime start);
+  SimTime delegate_get_impl(std::uint64_t key, Metrics& m, std::uint64_t op_id, SimTime start);
+  void delegate_put_impl(std::uint64_t key, Metrics& m, std::uint64_t op_id, SimTime start);
+  void finish_combined(OpType kind, Metrics& m, const rdwc::DelegationTable::Waiter& w, SimTime done);
 
-  // Hopscotch overlay methods
-  void hopscotch_maybe_create_overlay(std::uint64_t leaf_id, Metrics& m);
-  void hopscotch_update_overlay(std::uint64_t leaf_id, std::uint64_t key, int leaf_slot);
-  void hopscotch_remove_from_overlay(std::uint64_t leaf_id, std::uint64_t key);
-  int hopscotch_probe_overlay(std::uint64_t leaf_id, std::uint64_t key, Metrics& m);
-  void hopscotch_track_leaf_access(std::uint64_t leaf_id);
+  // Hopscotch overlay: the leaf's overlay if its read should go through it
+  hopscotch::HopscotchOverlay* hopscotch_leaf(std::uint64_t leaf, int depth, std::uint64_t key);
+  void hopscotch_learn(hopscotch::HopscotchOverlay& ov, std::uint64_t key);
+  void hopscotch_read(hopscotch::HopscotchOverlay& ov, std::uint64_t key, Metrics& m, SimTime& completion);
 
   int leaf_capacity() const;
   std::uint64_t glt_slot(std::uint64_t leaf) const;
+  Target lock_target(std::uint64_t leaf) const;
 };
\ No newline at end of file
@@ -1,51 +1,96 @@
 #pragma once
+#include "sim/parallel.h"
 #include <cstdint>
+#include <memory>
 #include <deque>
+#include <functional>
 #include <unordered_map>
 #include <vector>
 #include <algorithm>
 
-struct GLT { // global lock table (conceptual)
+// Global lock table of one memory node, shared by every compute node. Only the
+// PDES shard that owns it touches it (LockTables::glt_shard); other shards
+// send it their lock verbs as events.
+struct GLT {
   int slots{0};
-  // owner per slot: -1 = free, otherwise tid (or any small owner id)
-  std::vector<int> owner;
+  // owner per slot: -1 = free, otherwise the holding op's id
+  std::vector<std::int64_t> owner;
   explicit GLT(int n): slots(n), owner(n, -1) {}
+  bool try_lock(std::size_t slot, std::int64_t holder){
+    if (owner[slot] != -1) return false;
+    owner[slot] = holder; return true;
+  }
+  void unlock(std::size_t slot, std::int64_t holder){ if (owner[slot] == holder) owner[slot] = -1; }
+  void pass(std::size_t slot, std::int64_t holder, std::int64_t next){ if (owner[slot] == holder) owner[slot] = next; }
 };
 
-struct LLT { // local fairness & handoff (per-CS)
-  // per-leaf local FIFO of threads
-  std::unordered_map<std::uint64_t, std::deque<int>> waiters;
-
-  // Enqueue tid if not present; return its position in FIFO
-  int enqueue_and_pos(std::uint64_t key, int tid){
-    auto& q = waiters[key];
-    auto it = std::find(q.begin(), q.end(), tid);
-    if (it == q.end()) {
-      q.push_back(tid);
-      return static_cast<int>(q.size()) - 1;
-    }
-    return static_cast<int>(std::distance(q.begin(), it));
+struct LLT { // local fairness & handoff, one per compute node (its threads share a shard)
+  // Per-leaf FIFO of lock holders. Only the head goes for the global lock;
+  // the others wait locally and are woken when they reach the head, told
+  // whether the global lock was handed to them along with it.
+  struct Waiter { std::int64_t holder{-1}; std::function<void(bool handed_over)> wake; };
+  struct Queue { std::deque<Waiter> q; int handovers{0}; }; // consecutive hand-overs
+  std::unordered_map<std::uint64_t, Queue> waiters;
+
+  // Enqueue holder; returns its position (0 = head).
+  int enqueue(std::uint64_t key, std::int64_t holder, std::function<void(bool)> wake){
+    auto& q = waiters[key].q;
+    q.push_back(Waiter{holder, std::move(wake)});
+    return static_cast<int>(q.size()) - 1;
+  }
+
+  bool at_head(std::uint64_t key, std::int64_t holder){
+    auto it = waiters.find(key);
+    return it != waiters.end() && !it->second.q.empty() && it->second.q.front().holder == holder;
+  }
+
+  // Next in line behind the head (-1 if none), who a hand-over passes to.
+  std::int64_t successor(std::uint64_t key) const {
+    auto it = waiters.find(key);
+    return it != waiters.end() && it->second.q.size() > 1 ? it->second.q[1].holder : -1;
   }
 
-  // Is tid at head?
-  bool at_head(std::uint64_t key, int tid){
-    auto& q = waiters[key];
-    return !q.empty() && q.front() == tid;
+  // May the head pass the global lock straight to the next local waiter?
+  bool can_hand_over(std::uint64_t key, int max_depth){
+    auto it = waiters.find(key);
+    return it != waiters.end() && it->second.q.size() > 1 && it->second.handovers < max_depth;
   }
 
-  // Release head if tid owns it
-  void release(std::uint64_t key, int tid){
-    auto& q = waiters[key];
-    if (!q.empty() && q.front() == tid) {
+  // Remove holder; if it was the head, returns the new head (holder -1 if none).
+  // handover: the global lock goes with it, counting toward the depth limit.
+  Waiter release(std::uint64_t key, std::int64_t holder, bool handover){
+    auto it = waiters.find(key);
+    if (it == waiters.end()) return {};
+    auto& q = it->second.q;
+    Waiter next;
+    if (!q.empty() && q.front().holder == holder){
       q.pop_front();
+      if (!q.empty()) next = q.front();
     } else {
-      // best-effort cleanup if tid is somewhere else (shouldn't happen on correct usage)
-      auto it = std::find(q.begin(), q.end(), tid);
-      if (it != q.end()) q.erase(it);
-    }
-    if (q.empty()){
-      // optional: shrink map usability
-      // waiters.erase(key); // keep for locality if you prefer
+      auto w = std::find_if(q.begin(), q.end(), [&](const Waiter& x){ return x.holder == holder; });
+      if (w != q.end()) q.erase(w);
     }
+    it->second.handovers = (handover && next.wake) ? it->second.handovers + 1 : 0;
+    if (q.empty()) waiters.erase(it);
+    return next;
+  }
+};
+
+// Lock tables of a run. Leaf l's lock word lives on memory node
+// l % memory_nodes, whatever compute node takes it; memory node ms's GLT on
+// shard ms % shards. A lock verb acts on the GLT when it reaches the lock word,
+// lead_us (half the cheapest round trip) before it completes: far enough ahead
+// for the owning shard to get the request and send the outcome back in time.
+struct LockTables {
+  std::vector<std::unique_ptr<GLT>> glt; // per memory node
+  std::vector<std::unique_ptr<LLT>> llt; // per compute node
+  Pdes& pdes;
+  SimTime lead_us;
+  LockTables(int memory_nodes, int compute_nodes, int glt_slots, Pdes& p, SimTime lead)
+    : pdes(p), lead_us(lead) {
+    for (int i=0; i<memory_nodes; ++i) glt.push_back(std::make_unique<GLT>(glt_slots));
+    for (int i=0; i<compute_nodes; ++i) llt.push_back(std::make_unique<LLT>());
   }
-};
\ No newline at end of file
+  int home(std::uint64_t leaf) const { return (int)(leaf % glt.size()); }
+  int glt_shard(int ms) const { return ms % pdes.size(); }
+};
@@ -0,0 +1,38 @@
+#pragma once
+#include "sim/capacity.h"
+#include "sim/config.h"
+#include "sim/types.h"
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// One memory server: DRAM behind a bandwidth-limited channel (plus dram_lat_us
+// per access) and cpu_cores cores serving RPC work. Shared by every shard like
+// a Port (`shard` is the caller's); times are absolute sim time.
+class MemoryServer {
+public:
+  MemoryServer(const MemoryConf& c, int cpu_cores);
+  // Completion of a bytes-sized DRAM access that reaches the server at `arrive`.
+  SimTime dram(SimTime arrive, std::size_t bytes, int shard = 0);
+  // Completion of service_us of CPU work that reaches the server at `arrive`.
+  SimTime cpu(SimTime arrive, double service_us, int shard = 0);
+  double dram_lat_us() const { return conf.dram_lat_us; }
+  void shards(int n){ channel.shards(n); cores.shards(n); }
+  void commit(){ channel.commit(); cores.commit(); }
+
+private:
+  MemoryConf conf;
+  SlotCalendar channel, cores;
+};
+
+// The memory servers of a run, indexed by ms_id.
+struct MemoryPool {
+  MemoryConf conf;
+  std::vector<std::unique_ptr<MemoryServer>> servers;
+  MemoryPool(const MemoryConf& c, int memory_nodes, int cpu_cores);
+  MemoryServer& at(int ms){ return *servers[ms % servers.size()]; }
+  void shards(int n){ for (auto& s : servers) s->shards(n); }
+  void commit(){ for (auto& s : servers) s->commit(); }
+  // Lock words that fit in the RNIC's on-chip memory; the rest live in DRAM.
+  std::uint64_t onchip_lock_slots() const { return conf.onchip_bytes / std::max<std::size_t>(1, conf.lock_bytes); }
+};
@@ -1,22 +1,170 @@
 #pragma once
+#include "sim/types.h"
+#include "sim/op_trace.h"
 #include <atomic>
 #include <cstdint>
-#include <mutex>
+#include <bit>
 #include <string>
+#include <tuple>
 #include <vector>
-#include <fstream>
+#include <functional>
+#include <memory>
 #include <algorithm>
 #include <cmath>
 
+// Log-bucketed latency histogram (HDR-style). Values are recorded in
+// nanoseconds: exact below kSub, then kSub linear sub-buckets per power of two,
+// so any reported value is within 2^-kSubBits of the recorded one. Memory is
+// fixed, record is O(1) and histograms merge by adding counts.
 struct Hist {
-  void clear() { vals.clear(); }
-  std::vector<double> vals;
-  void add(double v){ vals.push_back(v); }
+  static constexpr int kSubBits = 7;
+  static constexpr std::uint64_t kSub = 1ull << kSubBits;
+  static constexpr std::size_t kBuckets = kSub * (64 - kSubBits + 1);
+
+  std::vector<std::uint64_t> counts = std::vector<std::uint64_t>(kBuckets, 0);
+  std::uint64_t n{0};
+  double sum{0}, lo{0}, hi{0};
+
+  static std::size_t index_of(std::uint64_t v){
+    if (v < kSub) return static_cast<std::size_t>(v);
+    const int msb = 63 - std::countl_zero(v);
+    const int shift = msb - kSubBits;
+    return static_cast<std::size_t>(kSub + std::uint64_t(shift) * kSub + ((v >> shift) - kSub));
+  }
+  // [first, last] nanoseconds covered by bucket i
+  static std::uint64_t bucket_lo(std::size_t i){
+    if (i < kSub) return i;
+    const std::uint64_t shift = (i - kSub) / kSub, sub = (i - kSub) % kSub;
+    return (kSub + sub) << shift;
+  }
+  static std::uint64_t bucket_hi(std::size_t i){
+    if (i < kSub) return i;
+    const std::uint64_t shift = (i - kSub) / kSub;
+    return bucket_lo(i) + (std::uint64_t(1) << shift) - 1;
+  }
+
+  static std::size_t bucket_of(double us){
+    const double ns = std::max(0.0, us) * 1e3;
+    return index_of(ns >= 1.8e19 ? ~0ull : static_cast<std::uint64_t>(std::llround(ns)));
+  }
+  static double bucket_mid_us(std::size_t i){ return 0.5 * double(bucket_lo(i) + bucket_hi(i)) / 1e3; }
+
+  void clear(){ std::fill(counts.begin(), counts.end(), 0); n = 0; sum = lo = hi = 0; }
+  void add(double us){
+    counts[bucket_of(us)]++;
+    lo = n ? std::min(lo, us) : us; hi = n ? std::max(hi, us) : us;
+    ++n; sum += us;
+  }
+  void merge(const Hist& o){
+    if (!o.n) return;
+    for (std::size_t i = 0; i < kBuckets; ++i) counts[i] += o.counts[i];
+    lo = n ? std::min(lo, o.lo) : o.lo; hi = n ? std::max(hi, o.hi) : o.hi;
+    n += o.n; sum += o.sum;
+  }
+  std::uint64_t count() const { return n; }
+  double mean() const { return n ? sum / double(n) : 0.0; }
+  // Same rank rule as a sorted-vector lookup: element floor(p/100 * (n-1)).
+  // Returns the bucket midpoint, clamped to the observed min/max.
   double pct(double p) const {
-    if (vals.empty()) return 0.0;
-    auto v = vals; std::sort(v.begin(), v.end());
-    std::size_t idx = std::min<std::size_t>(static_cast<std::size_t>(std::floor((p/100.0)*(v.size()-1))), v.size()-1);
-    return v[idx];
+    if (!n) return 0.0;
+    const std::uint64_t rank = std::min<std::uint64_t>(static_cast<std::uint64_t>(std::floor((p/100.0)*double(n-1))), n-1);
+    std::uint64_t seen = 0;
+    for (std::size_t i = 0; i < kBuckets; ++i){
+      seen += counts[i];
+      if (seen > rank){
+        return std::clamp(bucket_mid_us(i), lo, hi);
+      }
+    }
+    return hi;
+  }
+};
+
+// Latency breakdowns by op latency: per coarse log bucket (every 16 Hist
+// buckets, 8 per power of two) the op count, summed latency and summed parts,
+// so percentile bands are cut after the run. The last part is the remainder
+// no component explains (RDWC waits, lock hand-over delays, RPC hops).
+struct BreakdownHist {
+  static constexpr int kParts = LatBreakdown::kParts + 1; // + other
+  static constexpr std::size_t kCells = Hist::kBuckets / 16;
+  struct Cell { std::uint64_t n{0}; double lat{0}; double us[kParts]{}; };
+  std::vector<Cell> cells; // sized on first add
+
+  void clear(){ cells.clear(); }
+  void add(double lat, const LatBreakdown& bd){
+    if (cells.empty()) cells.resize(kCells);
+    Cell& c = cells[Hist::bucket_of(lat) / 16];
+    c.n++; c.lat += lat;
+    for (int p = 0; p < LatBreakdown::kParts; ++p) c.us[p] += bd.us[p];
+    const double rest = lat - bd.total(); // float noise aside, only what is unexplained
+    if (rest > 1e-9) c.us[kParts - 1] += rest;
+  }
+  void merge(const BreakdownHist& o){
+    if (o.cells.empty()) return;
+    if (cells.empty()) cells.resize(kCells);
+    for (std::size_t i = 0; i < kCells; ++i){
+      cells[i].n += o.cells[i].n; cells[i].lat += o.cells[i].lat;
+      for (int p = 0; p < kParts; ++p) cells[i].us[p] += o.cells[i].us[p];
+    }
+  }
+  // Ops ranked in [lo, hi) percent of this histogram; a cell straddling an
+  // edge contributes pro rata. Sums, not means.
+  struct Band { double n{0}, lat{0}; double us[kParts]{}; };
+  Band band(double lo, double hi) const {
+    Band out;
+    std::uint64_t total = 0;
+    for (const auto& c : cells) total += c.n;
+    const double r0 = lo / 100.0 * double(total), r1 = hi / 100.0 * double(total);
+    double seen = 0;
+    for (const auto& c : cells){
+      if (!c.n) continue;
+      const double a = std::max(seen, r0), b = std::min(seen + double(c.n), r1);
+      seen += double(c.n);
+      if (b <= a) continue;
+      const double f = (b - a) / double(c.n);
+      out.n += b - a; out.lat += f * c.lat;
+      for (int p = 0; p < kParts; ++p) out.us[p] += f * c.us[p];
+    }
+    return out;
+  }
+};
+
+// One sim-time window of a run: deltas of the remote-verb, byte and cache
+// counters, plus a latency histogram over cells of kGroup Hist buckets (32 per
+// power of two, within 2% of the recorded value). Cells are allocated on the
+// first op, so memory is fixed per window whatever the op count.
+struct Window {
+  static constexpr std::size_t kGroup = 4;
+  static constexpr std::size_t kCells = Hist::kBuckets / kGroup;
+  std::uint64_t ops{0}, reads{0}, writes{0}, cas{0}, bytes_r{0}, bytes_w{0}, cache_hits{0}, cache_misses{0};
+  std::vector<std::uint32_t> lat; // kCells once an op completed
+  double lo{0}, hi{0};
+
+  void add(double us){
+    if (lat.empty()) lat.resize(kCells);
+    lo = ops ? std::min(lo, us) : us; hi = ops ? std::max(hi, us) : us;
+    ++ops;
+    lat[Hist::bucket_of(us) / kGroup]++;
+  }
+  void merge(const Window& o){
+    reads += o.reads; writes += o.writes; cas += o.cas;
+    bytes_r += o.bytes_r; bytes_w += o.bytes_w; cache_hits += o.cache_hits; cache_misses += o.cache_misses;
+    if (!o.ops) return;
+    if (lat.empty()) lat.resize(kCells);
+    for (std::size_t i = 0; i < kCells; ++i) lat[i] += o.lat[i];
+    lo = ops ? std::min(lo, o.lo) : o.lo; hi = ops ? std::max(hi, o.hi) : o.hi;
+    ops += o.ops;
+  }
+  // Same rank rule as Hist::pct, at cell resolution.
+  double pct(double p) const {
+    if (!ops) return 0.0;
+    const std::uint64_t rank = std::min<std::uint64_t>(static_cast<std::uint64_t>(std::floor((p/100.0)*double(ops-1))), ops-1);
+    std::uint64_t seen = 0;
+    for (std::size_t i = 0; i < kCells; ++i){
+      seen += lat[i];
+      if (seen > rank)
+        return std::clamp(0.5 * double(Hist::bucket_lo(i * kGroup) + Hist::bucket_hi(i * kGroup + kGroup - 1)) / 1e3, lo, hi);
+    }
+    return hi;
   }
 };
 
@@ -30,24 +178,127 @@ struct Metrics {
     recv_ops = 0;
     bytes_read = 0;
     bytes_write = 0;
-    hopscotch_hits = 0;
+    hopscotch_hits = 0; hopscotch_spec_fails = 0; hopscotch_bytes_saved = 0;
+    lock_spills = 0;
+    stale_hits = 0; stale_retries = 0;
+    lock_wait_us.clear(); lock_retries = 0; lock_handovers = 0; handover_saved_verbs = 0;
+    rdwc_reads = 0; rdwc_writes = 0; std::fill(cas_per_write.begin(), cas_per_write.end(), 0);
+    scans = 0; scan_bytes_r = 0; scan_lat_us.clear();
+    issued = 0; first_issue = last_issue = last_done = 0;
     lat_us.clear();
+    for (auto& b : breakdown) b.clear();
+    window_us = 0; windows.clear(); open = 0; snap = Window{}; cache_probe = nullptr;
     trace_enabled = false;
-    if (trace.is_open()) trace.close();
+    trace.reset();
   }
   std::atomic<std::uint64_t> ops{0};
   std::atomic<std::uint64_t> remote_reads{0}, remote_writes{0}, remote_cas{0}, send_ops{0}, recv_ops{0};
   std::atomic<std::uint64_t> bytes_read{0}, bytes_write{0};
-  std::atomic<std::uint64_t> hopscotch_hits{0}; // Sprint 2: hopscotch overlay hits
-  std::mutex lat_m; Hist lat_us;
+  // Hopscotch overlay: lookups answered from it, stale speculative slots, and
+  // leaf bytes not read compared to fetching the whole leaf
+  std::atomic<std::uint64_t> hopscotch_hits{0}, hopscotch_spec_fails{0}, hopscotch_bytes_saved{0};
+  std::atomic<std::uint64_t> lock_spills{0};    // HOCL lock acquires whose GLT word spilled to DRAM
+  std::atomic<std::uint64_t> stale_hits{0};     // cache hits on nodes changed since they were cached
+  std::atomic<std::uint64_t> stale_retries{0};  // traversals restarted below a stale node
+  // Write locks: first CAS to ownership, failed CAS, and CAS per acquire
+  // (last bucket collects kMaxCasPerWrite and more)
+  static constexpr std::size_t kMaxCasPerWrite = 64;
+  Hist lock_wait_us;
+  std::atomic<std::uint64_t> lock_retries{0};
+  std::atomic<std::uint64_t> lock_handovers{0}, handover_saved_verbs{0}; // HOCL local hand-over
+  std::atomic<std::uint64_t> rdwc_reads{0}, rdwc_writes{0}; // ops completed by another thread's delegation
+  std::vector<std::uint64_t> cas_per_write = std::vector<std::uint64_t>(kMaxCasPerWrite + 1, 0);
+  Hist lat_us;
+  BreakdownHist breakdown[3]; // by OpType
+  // Range scans, also broken out on their own (they are in ops/lat_us too)
+  std::atomic<std::uint64_t> scans{0}, scan_bytes_r{0};
+  Hist scan_lat_us;
+
+  // Load/throughput bookkeeping (sim time, us)
+  std::uint64_t issued{0};
+  SimTime first_issue{0}, last_issue{0}, last_done{0};
+  void on_issue(SimTime t){ first_issue = issued ? std::min(first_issue, t) : t; last_issue = std::max(last_issue, t); ++issued; }
+  void on_done(SimTime t){ last_done = std::max(last_done, t); }
+  SimTime makespan_us() const { return issued ? last_done - first_issue : 0.0; }
 
-  // Optional per-op CSV trace
+  // Fold another (quiescent) Metrics into this one, e.g. per-shard results.
+  void merge(Metrics& o){
+    ops += o.ops.load();
+    remote_reads += o.remote_reads.load(); remote_writes += o.remote_writes.load(); remote_cas += o.remote_cas.load();
+    send_ops += o.send_ops.load(); recv_ops += o.recv_ops.load();
+    bytes_read += o.bytes_read.load(); bytes_write += o.bytes_write.load();
+    hopscotch_hits += o.hopscotch_hits.load(); hopscotch_spec_fails += o.hopscotch_spec_fails.load();
+    hopscotch_bytes_saved += o.hopscotch_bytes_saved.load();
+    lock_spills += o.lock_spills.load();
+    stale_hits += o.stale_hits.load(); stale_retries += o.stale_retries.load();
+    lock_wait_us.merge(o.lock_wait_us); lock_retries += o.lock_retries.load();
+    lock_handovers += o.lock_handovers.load(); handover_saved_verbs += o.handover_saved_verbs.load();
+    rdwc_reads += o.rdwc_reads.load(); rdwc_writes += o.rdwc_writes.load();
+    for (std::size_t i = 0; i < cas_per_write.size(); ++i) cas_per_write[i] += o.cas_per_write[i];
+    scans += o.scans.load(); scan_bytes_r += o.scan_bytes_r.load(); scan_lat_us.merge(o.scan_lat_us);
+    if (o.issued){
+      first_issue = issued ? std::min(first_issue, o.first_issue) : o.first_issue;
+      last_issue = std::max(last_issue, o.last_issue);
+      issued += o.issued;
+    }
+    last_done = std::max(last_done, o.last_done);
+    lat_us.merge(o.lat_us);
+    for (int t = 0; t < 3; ++t) breakdown[t].merge(o.breakdown[t]);
+    if (windows.size() < o.windows.size()) windows.resize(o.windows.size());
+    for (std::size_t i = 0; i < o.windows.size(); ++i) windows[i].merge(o.windows[i]);
+  }
+
+  // Sim-time windows (window_us > 0): window i covers [i, i+1) * window_us.
+  // Counters are charged to the open window, the one holding the shard's
+  // current time; roll() runs from the shard loop's tick before the first
+  // event of each window, so verbs count where they are posted.
+  SimTime window_us{0};
+  std::vector<Window> windows;
+  std::size_t open{0};
+  std::function<std::pair<std::uint64_t, std::uint64_t>()> cache_probe; // cumulative (hits, misses)
+  Window snap; // counter values when the open window started
+
+  std::size_t window_of(SimTime t) const { return static_cast<std::size_t>(std::max(0.0, t) / window_us); }
+  void roll(SimTime t){
+    if (window_us <= 0) return;
+    const std::size_t i = window_of(t);
+    if (windows.size() <= i) windows.resize(i + 1);
+    if (i <= open) return;
+    close_window();
+    open = i;
+  }
+  // Charge counter growth since the last snapshot to the open window.
+  void close_window(){
+    if (windows.empty()) return;
+    Window now;
+    now.reads = remote_reads; now.writes = remote_writes; now.cas = remote_cas;
+    now.bytes_r = bytes_read; now.bytes_w = bytes_write;
+    if (cache_probe) std::tie(now.cache_hits, now.cache_misses) = cache_probe();
+    auto& w = windows[open];
+    w.reads += now.reads - snap.reads; w.writes += now.writes - snap.writes; w.cas += now.cas - snap.cas;
+    w.bytes_r += now.bytes_r - snap.bytes_r; w.bytes_w += now.bytes_w - snap.bytes_w;
+    w.cache_hits += now.cache_hits - snap.cache_hits; w.cache_misses += now.cache_misses - snap.cache_misses;
+    snap = now;
+  }
+
+  // Optional per-op trace (sim/op_trace.h), possibly sampled
   bool trace_enabled{false};
-  std::ofstream trace;
-  void open_trace(const std::string& path){ if(trace_enabled){ trace.open(path); trace << "op_id,type,latency_us,reads,writes,cas,sends,recvs,bytes_r,bytes_w\n"; } }
-  void add_latency(double us){ std::lock_guard<std::mutex> g(lat_m); lat_us.add(us); }
-  void dump_op(std::uint64_t id, const std::string& type, double lat, std::uint64_t r, std::uint64_t w, std::uint64_t c, std::uint64_t s, std::uint64_t rv, std::uint64_t br, std::uint64_t bw){
-    if (!trace_enabled || !trace.good()) return;
-    trace << id << ',' << type << ',' << lat << ',' << r << ',' << w << ',' << c << ',' << s << ',' << rv << ',' << br << ',' << bw << "\n";
+  std::unique_ptr<optrace::Writer> trace;
+  void open_trace(const std::string& path, const optrace::Options& o){ if(trace_enabled) trace = std::make_unique<optrace::Writer>(path, o); }
+  void close_trace(){ if (trace) trace->close(); }
+  // `lat` must be the op's whole latency; what `bd` leaves unexplained is "other"
+  void add_breakdown(OpType t, double lat, const LatBreakdown& bd){ breakdown[static_cast<int>(t)].add(lat, bd); }
+  // `at` is the completion time, which picks the op's window
+  void add_latency(double us, SimTime at){
+    lat_us.add(us);
+    if (window_us <= 0) return;
+    const std::size_t i = window_of(at);
+    if (windows.size() <= i) windows.resize(i + 1);
+    windows[i].add(us);
+  }
+  void dump_op(std::uint64_t id, OpType type, double lat, std::uint64_t r, std::uint64_t w, std::uint64_t c, std::uint64_t s, std::uint64_t rv, std::uint64_t br, std::uint64_t bw){
+    if (!trace) return;
+    auto u32 = [](std::uint64_t v){ return static_cast<std::uint32_t>(std::min<std::uint64_t>(v, ~0u)); };
+    trace->add(optrace::Record{id, lat, u32(r), u32(w), u32(c), u32(s), u32(rv), u32(br), u32(bw), static_cast<std::uint8_t>(type), {}});
   }
 };
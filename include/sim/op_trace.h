@@ -0,0 +1,101 @@
+#pragma once
+#include "sim/types.h"
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Per-op result traces. File layout (little endian):
+//   header  magic "RDMOPTR1", u32 version (1), u32 flags, u64 records,
+//           u64 seen (ops offered to the writer), u64 sample (N or reservoir size)
+//   body    records back to back, or with kCompressed a sequence of chunks
+//           u32 raw_bytes, u32 zlib_bytes, zlib stream; each chunk holds whole records
+// Counters saturate at 2^32-1.
+namespace optrace {
+
+constexpr char kMagic[8] = {'R','D','M','O','P','T','R','1'};
+constexpr std::uint32_t kVersion = 1;
+constexpr std::uint32_t kCompressed = 1; // flag: body is zlib chunks
+constexpr std::uint32_t kEveryN = 2;     // flag: 1-in-`sample` ops kept
+constexpr std::uint32_t kReservoir = 4;  // flag: uniform reservoir of `sample` ops
+
+struct Header { char magic[8]; std::uint32_t version, flags; std::uint64_t records, seen, sample; };
+static_assert(sizeof(Header) == 40);
+
+struct Record {
+  std::uint64_t op_id;
+  double latency_us;
+  std::uint32_t reads, writes, cas, sends, recvs, bytes_r, bytes_w;
+  std::uint8_t type, pad[3]; // OpType
+};
+static_assert(sizeof(Record) == 48);
+
+struct Options {
+  std::uint64_t sample_every{1}; // keep every N-th op (1 = all)
+  std::uint64_t reservoir{0};    // >0: keep a uniform sample of this many ops instead
+  bool compress{true};
+};
+
+// Appends records into large chunks that a background thread compresses and
+// writes, so the simulation thread only copies 48 bytes per kept op. At most a
+// few chunks are in flight; add() blocks when the writer falls that far behind.
+class Writer {
+public:
+  Writer(const std::string& path, const Options& o); // throws std::runtime_error
+  ~Writer();
+  Writer(const Writer&) = delete;
+  Writer& operator=(const Writer&) = delete;
+
+  void add(const Record& r){
+    ++hdr.seen;
+    if (hdr.flags & kReservoir){ sample(r); return; }
+    if (--skip) return;
+    skip = hdr.sample;
+    chunk.push_back(r);
+    if (chunk.size() == kChunkRecords) flush();
+  }
+  void close();
+  std::uint64_t seen() const { return hdr.seen; }
+
+  static constexpr std::size_t kChunkRecords = (1 << 20) / sizeof(Record);
+
+private:
+  void sample(const Record& r);
+  void flush();
+  void run();
+
+  Header hdr{};
+  std::FILE* f{nullptr};
+  std::uint64_t skip{1}, rng{0x9e3779b97f4a7c15ull};
+  std::vector<Record> chunk;
+
+  std::mutex mu;
+  std::condition_variable cv;
+  std::deque<std::vector<Record>> queue;
+  bool stop{false};
+  std::thread bg;
+};
+
+// Whole-file reader; decompresses chunks as it goes.
+class Reader {
+public:
+  explicit Reader(const std::string& path); // throws std::runtime_error
+  ~Reader();
+  Reader(const Reader&) = delete;
+  Reader& operator=(const Reader&) = delete;
+
+  const Header& header() const { return hdr; }
+  // Next batch of records; false at end of file.
+  bool next(std::vector<Record>& out);
+
+private:
+  Header hdr{};
+  std::FILE* f{nullptr};
+  std::uint64_t left{0};
+};
+
+} // namespace optrace
@@ -0,0 +1,45 @@
+#pragma once
+#include "sim/event_loop.h"
+#include <memory>
+#include <vector>
+
+// Conservative parallel discrete-event simulation over a fixed set of shards.
+// Each shard owns an EventLoop driven by its own worker thread. Shards advance
+// in lock-step windows [T, T + lookahead), where T is the earliest pending
+// event across all shards; cross-shard events must be scheduled at least one
+// lookahead into the sender's future and are delivered at the window barrier.
+// With a single shard run() is exactly EventLoop::run().
+class Pdes {
+public:
+  Pdes(int shards, EventQueueKind kind, SimTime lookahead_us);
+
+  int size() const { return static_cast<int>(loops.size()); }
+  EventLoop& loop(int s){ return *loops[s]; }
+  SimTime lookahead() const { return lookahead_; }
+
+  // Schedule fn on shard dst from shard src. Times closer than one lookahead
+  // to the sender's clock are clamped forward (the conservative guarantee).
+  void send(int src, int dst, SimTime t, EventFn fn);
+
+  // Run fn at every window barrier, before remote events are delivered, while
+  // no shard is running (e.g. to fold per-shard updates into shared state).
+  // Never runs with a single shard.
+  void at_barrier(EventFn fn){ barrier_steps.push_back(std::move(fn)); }
+  // End of the window being run, or just finished inside a barrier step.
+  SimTime window_end() const { return horizon; }
+
+  void run();
+  std::uint64_t windows() const { return windows_; }
+
+private:
+  struct Remote { int dst; SimTime t; EventFn fn; };
+  std::vector<std::unique_ptr<EventLoop>> loops;
+  std::vector<std::vector<Remote>> outbox; // per source shard, drained at barriers
+  std::vector<EventFn> barrier_steps;
+  SimTime lookahead_;
+  SimTime horizon{0.0};
+  bool done{false};
+  std::uint64_t windows_{0};
+
+  void end_window();
+};
@@ -3,12 +3,14 @@
 #include "sim/event_loop.h"
 #include <unordered_map>
 #include <algorithm>
+#include <deque>
 
 struct TokenBucket {
   double rate_ops_per_us{0};
   double burst{0};
   double tokens{0};
   double last_refill{0};
+  double starved_us{0}, starved_until{0}; // time with a token deficit (waiters queued)
   void init(double ops_per_s, double burst_, double now){ rate_ops_per_us=ops_per_s/1e6; burst=burst_; tokens=burst; last_refill=now; }
   double acquire(double need, double now){
     // Refill
@@ -19,6 +21,8 @@ struct TokenBucket {
     double wait_us = deficit / rate_ops_per_us;
     tokens = 0;
     last_refill = now + wait_us;
+    starved_us += last_refill - std::max(now, starved_until);
+    starved_until = last_refill;
     return now + wait_us;
   }
 };
@@ -26,12 +30,41 @@ struct TokenBucket {
 struct QPState {
   SimTime ready_at{0.0};      // completion frontier
   SimTime post_ready_at{0.0}; // PCIe posting frontier
-  int outstanding{0};
+  int outstanding{0};         // verbs in the send queue as of last_change
+  std::deque<SimTime> queued;   // completions of verbs possibly still queued, oldest first
+  std::deque<SimTime> entering; // queue entries of posted verbs not yet counted in outstanding
   TokenBucket tb_cas, tb_read, tb_write;
+  // the verb that set ready_at: when it was posted and its critical path
+  SimTime last_posted{-1.0};
+  LatBreakdown last_path;
+  // Utilization (sim time, us): verbs and bytes posted, time with verbs in
+  // flight, outstanding integrated over time and its peak, time posts were
+  // held back by a full send queue. A verb counts from when it enters the
+  // queue (once posting and any SQ stall are over) until it completes.
+  std::uint64_t verbs{0}, bytes{0};
+  SimTime busy_us{0}, occupancy_us{0}, sq_blocked_us{0}, last_change{0};
+  int max_outstanding{0};
+  void occupy(SimTime now, int delta){
+    for (; !entering.empty() && entering.front() <= now; entering.pop_front()) step(entering.front(), +1);
+    step(now, delta);
+  }
+  void step(SimTime now, int delta){
+    const SimTime dt = now - last_change;
+    if (outstanding > 0) busy_us += dt;
+    occupancy_us += outstanding * dt;
+    last_change = now;
+    outstanding += delta;
+  }
 };
 
+struct MemoryPool;
+struct Fabric;
+
 struct NIC {
   EventLoop& loop;
+  MemoryPool* mem{nullptr}; // servers behind DRAM targets; null = wire cost only
+  Fabric* fabric{nullptr};  // node ports shared with other NICs; null = every QP owns a full link
+  int shard{0};             // PDES shard this NIC runs on, for reservations on shared ports
   struct Caps {
     double link_gbps, base_rtt_us, per_byte_us, cas_onchip_rtt_us;
     bool in_order_rc; int qp_per_thread;
@@ -40,10 +73,16 @@ struct NIC {
     double tb_cas_ops_per_s, tb_read_ops_per_s, tb_write_ops_per_s, tb_burst_ops;
   } caps;
   std::unordered_map<long long, QPState> qpstate; // key = ((long long)cs<<32)|qp
-  TokenBucket nic_tb_read, nic_tb_write, nic_tb_cas;
 
   NIC(EventLoop& l, const Caps& in_caps);
   double bytes_per_us() const;
   Completion post(const RdmaReq& r);
   Completion post_chain(const std::vector<RdmaReq>& chain);
+  // Critical path of the verbs posted on (cs, qp) at `at`: the last one's,
+  // since it completes last (completions are in order per QP). Empty if
+  // nothing was posted then.
+  LatBreakdown path(int cs, int qp, SimTime at) const;
+
+private:
+  SimTime through_fabric(const RdmaReq& r, SimTime start);
 };
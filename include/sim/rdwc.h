@@ -1,80 +1,99 @@
 #pragma once
+#include "sim/types.h"
 #include <cstdint>
 #include <vector>
-#include <unordered_map>
-#include <mutex>
-#include <condition_variable>
-#include <functional>
-#include <chrono>
+
+struct Index;
 
 namespace rdwc {
 
-enum class DelegationState { ACTIVE, COMPLETED, FAILED };
+// Read/write delegation with coalescing (SMART-style), on simulated time. One
+// table per compute node, shared by its threads; they all run on one shard, so
+// nothing here is locked.
+//
+// Slots are direct-mapped by key hash, one array for reads and one for writes.
+// - Read: a get whose slot holds a read of the same key that started at most
+//   window_us ago and has not completed joins it and completes with it.
+// - Write: a put whose slot holds an open write of the same key (the delegate
+//   has not posted its write-back yet, started at most window_us ago) is
+//   combined into it and completes when the delegate's write does.
+// A slot held by a different key is a collision: BYPASS runs the op on its own,
+// QUEUE waits for the slot (read: the holder's completion; write: the holder's
+// write-back) and tries again.
+//
+// Combined writers wait in a pooled free list, so steady state allocates nothing.
+class DelegationTable {
+public:
+  enum class Policy { BYPASS, QUEUE };
+  struct Config { bool enable{false}; double window_us{100.0}; Policy collision{Policy::QUEUE}; int slots{4096}; };
+  enum class Join { Delegate, Combined, Bypass, Queued };
+  static constexpr std::uint32_t kNil = ~0u;
 
-struct Waiter {
-  std::uint64_t op_id;
-  std::function<void(bool success, const std::string& result)> callback;
-};
+  struct Waiter {
+    std::uint64_t key{0}, op_id{0};
+    SimTime start{0};           // when the op was issued
+    Index* issuer{nullptr};     // the thread's index instance
+    bool retry{false};          // queued behind another key, not combined
+    std::uint32_t next{kNil};
+  };
 
-struct DelegationEntry {
-  std::uint64_t unique_key;
-  DelegationState state{DelegationState::ACTIVE};
-  std::vector<Waiter> waiters;
-  bool write_pending{false};
-  std::vector<std::function<void()>> pending_writes; // for write combining
-  std::chrono::steady_clock::time_point start_time;
-  std::mutex mtx;
-  std::condition_variable cv;
-  std::string result; // cached result for GET delegation
-};
+  explicit DelegationTable(const Config& c);
+  const Config& config() const { return conf; }
 
-class DelegationTable {
-private:
-  static constexpr size_t NUM_SHARDS = 64;
-  
-  struct Shard {
-    std::mutex mtx;
-    std::unordered_map<std::uint64_t, std::shared_ptr<DelegationEntry>> entries;
-  };
-  
-  std::vector<Shard> shards;
-  
-  size_t shard_for_key(std::uint64_t key_hash) const {
-    return key_hash % NUM_SHARDS;
-  }
+  // Read of key at now. Delegate: run it, then read_done(key, completion).
+  // Combined / Queued: done is the holder's completion (complete / retry then).
+  Join read(std::uint64_t key, SimTime now, SimTime& done);
+  void read_done(std::uint64_t key, SimTime done);
 
-public:
-  // Config knobs
-  struct Config {
-    bool enable{true};
-    std::chrono::nanoseconds window_ns{std::chrono::microseconds(100)}; // 100us window
-    enum Policy { BYPASS, QUEUE } collision_policy{QUEUE};
-  } config;
+  // Write of key at now by op_id, issued at start. Delegate: run it and
+  // close_write once its write-back is posted; Combined / Queued: the waiter is
+  // parked on the slot until then.
+  Join write(std::uint64_t key, SimTime now, SimTime start, std::uint64_t op_id, Index* issuer);
 
-  DelegationTable() : shards(NUM_SHARDS) {}
+  // The delegate of key posts its write-back: the slot closes, queued waiters
+  // go to requeue(const Waiter&), and the combined ones are returned as a list
+  // for finish once the write completes.
+  template<class F>
+  std::uint32_t close_write(std::uint64_t key, F&& requeue){
+    if (!conf.enable) return kNil;
+    WriteSlot& s = wslots[slot_of(key)];
+    if (!s.open || s.key != key) return kNil;
+    std::uint32_t i = s.head, combined = kNil;
+    s.open = false; s.head = kNil;
+    while (i != kNil){
+      const std::uint32_t nx = pool[i].next;
+      if (pool[i].retry){ const Waiter w = pool[i]; release(i); requeue(w); }
+      else { pool[i].next = combined; combined = i; }
+      i = nx;
+    }
+    return combined;
+  }
 
-  // Returns: {is_delegate, delegation_entry}
-  // If is_delegate=true, caller should execute the operation and notify waiters
-  // If is_delegate=false, caller should wait on delegation_entry or bypass
-  std::pair<bool, std::shared_ptr<DelegationEntry>> 
-  try_delegate_get(std::uint64_t key, std::uint64_t op_id, 
-                   std::function<void(bool, const std::string&)> callback);
+  template<class F>
+  void finish(std::uint32_t list, F&& done){
+    while (list != kNil){
+      const std::uint32_t nx = pool[list].next;
+      const Waiter w = pool[list];
+      release(list);
+      done(w);
+      list = nx;
+    }
+  }
+
+private:
+  struct ReadSlot { std::uint64_t key{0}; SimTime start{0}, done{-1}; };
+  struct WriteSlot { std::uint64_t key{0}; SimTime start{0}; bool open{false}; std::uint32_t head{kNil}; };
 
-  std::pair<bool, std::shared_ptr<DelegationEntry>>
-  try_delegate_put(std::uint64_t key, std::uint64_t op_id,
-                   std::function<void()> write_op);
+  Config conf;
+  std::uint64_t mask;
+  std::vector<ReadSlot> rslots;
+  std::vector<WriteSlot> wslots;
+  std::vector<Waiter> pool;
+  std::uint32_t free_list{kNil};
 
-  void complete_delegation(std::uint64_t key_hash, bool success, const std::string& result = "");
-  
-  void cleanup_expired();
-  
-  // Metrics
-  struct Stats {
-    std::atomic<std::uint64_t> delegations_created{0};
-    std::atomic<std::uint64_t> delegation_hits{0};
-    std::atomic<std::uint64_t> delegation_bypasses{0};
-    std::atomic<std::uint64_t> write_combines{0};
-  } stats;
+  std::size_t slot_of(std::uint64_t key) const;
+  void park(WriteSlot& s, const Waiter& w);
+  void release(std::uint32_t i){ pool[i].next = free_list; free_list = i; }
 };
 
-} // namespace rdwc
\ No newline at end of file
+} // namespace rdwc
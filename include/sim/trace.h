@@ -0,0 +1,60 @@
+#pragma once
+#include "sim/types.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+// Key traces for replay. File layout (little endian):
+//   header  magic "RDMKTRC1", u32 version (1), u32 flags, u64 records, u64 max_key
+//   records u64 word = key << 2 | op (0 get, 1 put, 2 scan)
+//           [f64 arrival_us, when flags has kTraceArrivals]
+// Keys must fit in 62 bits. Records are fixed size, so record i is at
+// sizeof(header) + i * record_bytes.
+namespace trace {
+
+constexpr char kMagic[8] = {'R','D','M','K','T','R','C','1'};
+constexpr std::uint32_t kVersion = 1;
+constexpr std::uint32_t kArrivals = 1; // flag: records carry arrival times
+
+struct Header { char magic[8]; std::uint32_t version, flags; std::uint64_t records, max_key; };
+static_assert(sizeof(Header) == 32);
+
+struct Record { OpType op; std::uint64_t key; SimTime arrival_us; };
+
+// Read-only view of a trace file through mmap: pages come in as replay
+// reaches them, so a trace is never loaded whole. Safe to share across shards.
+class Reader {
+public:
+  explicit Reader(const std::string& path); // throws std::runtime_error
+  ~Reader();
+  Reader(const Reader&) = delete;
+  Reader& operator=(const Reader&) = delete;
+
+  std::uint64_t size() const { return hdr.records; }
+  std::uint64_t max_key() const { return hdr.max_key; }
+  bool has_arrivals() const { return hdr.flags & kArrivals; }
+  Record at(std::uint64_t i) const; // throws std::runtime_error on a bad op code
+
+private:
+  Header hdr{};
+  const unsigned char* base{nullptr};
+  std::size_t len{0}, rec_bytes{8};
+};
+
+// Streaming writer; the header's record count and max key are patched on close.
+class Writer {
+public:
+  Writer(const std::string& path, bool arrivals); // throws std::runtime_error
+  ~Writer();
+  void add(OpType op, std::uint64_t key, SimTime arrival_us = 0);
+  void close();
+  std::uint64_t size() const { return hdr.records; }
+  bool has_arrivals() const { return hdr.flags & kArrivals; }
+
+private:
+  Header hdr{};
+  std::FILE* f{nullptr};
+};
+
+} // namespace trace
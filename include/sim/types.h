@@ -10,6 +10,14 @@ enum class Verb { READ, WRITE, CAS, SEND, RECV };
 
 enum class Target { RNIC_ONCHIP, DRAM };
 
+enum class EventQueueKind { Heap, Calendar };
+
+enum class ZipfSampler { RejectionInversion, Cdf };
+
+enum class OpType { Get, Put, Scan };
+
+enum class CachePolicyKind { LRU, Clock, S3Fifo, TinyLfu };
+
 struct RdmaReq {
   Verb verb{};
   Target tgt{Target::DRAM};
@@ -17,6 +25,23 @@ struct RdmaReq {
   int qp{0};
   int cs_id{0};
   int ms_id{0};
+  int dst_cs{-1};     // two-sided message to another compute node; -1 = to memory server ms_id
+};
+
+// Critical-path attribution of a latency (us). Post: host posting (PCIe
+// descriptor and doorbell, waiting behind the QP's earlier posts). Sq: stalled
+// on a full send queue. Tokens: token-bucket waits. Queue: behind other ops'
+// verbs on the QP, at node ports and DRAM. Wire: unloaded wire/service time.
+// Lock: local lock queue and failed CAS. Backoff: between CAS retries.
+struct LatBreakdown {
+  enum Part { Post, Sq, Tokens, Queue, Wire, Lock, Backoff, kParts };
+  double us[kParts]{};
+  static const char* name(int p){
+    static const char* const n[kParts] = {"post", "sq", "tokens", "queue", "wire", "lock", "backoff"};
+    return n[p];
+  }
+  double total() const { double t = 0; for (double v : us) t += v; return t; }
+  LatBreakdown& operator+=(const LatBreakdown& o){ for (int p = 0; p < kParts; ++p) us[p] += o.us[p]; return *this; }
 };
 
-struct Completion { SimTime when{0.0}; };
+struct Completion { SimTime when{0.0}; LatBreakdown path; };
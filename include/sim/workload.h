@@ -1,17 +1,58 @@
 #pragma once
+#include "sim/client.h"
 #include "sim/config.h"
+#include "sim/fabric.h"
+#include "sim/hopscotch.h"
 #include "sim/index.h"
+#include "sim/index_dex.h"
+#include "sim/locks.h"
+#include "sim/memory_server.h"
+#include "sim/parallel.h"
+#include "sim/rdwc.h"
+#include "sim/trace.h"
 #include "sim/zipf.h"
 #include <memory>
+#include <string>
 #include <vector>
 
 struct WorkloadRunner {
+  // One PDES shard: a worker's event loop plus the NIC, metrics and index
+  // instances of the contiguous block of compute nodes it simulates.
+  struct Shard {
+    int id;
+    EventLoop& loop;
+    NIC nic;
+    Metrics metrics;
+    std::vector<std::unique_ptr<Index>> indices;
+    std::vector<std::unique_ptr<ClientThread>> clients; // one per index, unless client mode is batch
+    Shard(int i, EventLoop& l, const NIC::Caps& caps) : id(i), loop(l), nic(l, caps) { nic.shard = i; }
+  };
+
   SimConf conf;
-  EventLoop loop;
-  NIC nic;
-  Metrics metrics;
-  std::vector<std::unique_ptr<Index>> indices;
+  std::string scenario;  // first summary column
+  std::string trace_tag; // op-trace filename prefix, keeps scenarios sharing an out_dir apart
+  Metrics metrics; // merged over all shards after each run_workload
+  std::unique_ptr<BTreeModel> tree; // index structure of the current workload
+  std::unique_ptr<MemoryPool> mem;  // memory servers of the current workload
+  std::unique_ptr<Fabric> fabric;   // node NIC ports of the current workload
+  std::unique_ptr<Pdes> pdes;
+  std::unique_ptr<DexCluster> dex;  // shared DEX state, when index.kind is dex
+  std::vector<std::unique_ptr<NodeCache>> caches; // per compute node, shared by its threads
+  std::unique_ptr<LockTables> locks;                // GLT per memory node, LLT per compute node
+  std::vector<std::unique_ptr<rdwc::DelegationTable>> delegations; // RDWC, per compute node
+  std::vector<std::unique_ptr<hopscotch::OverlaySet>> overlays;    // leaf overlays, per compute node
+  std::unique_ptr<trace::Reader> key_trace; // workload.trace, when replaying one
+  std::vector<std::unique_ptr<Shard>> shards;
   WorkloadRunner(const SimConf& c);
-  std::unique_ptr<Index> make_index_for_cs(int cs_id, int ms_id, int qp, std::size_t cache_bytes);
-  void run_workload(const WorkloadCfg& wl, const std::string& index_name, const std::string& out_dir);
+  std::unique_ptr<Index> make_index_for_cs(Shard& sh, int cs_id, int ms_id, int qp);
+  // Runs one workload and returns its metrics_summary.csv row.
+  std::string run_workload(const WorkloadCfg& wl, const std::string& index_name, const std::string& out_dir);
+  static std::string summary_header(const MetricsCfg& mc);
+  // True if out_dir has no metrics_summary.csv yet or its header is `header`.
+  static bool summary_matches(const std::string& out_dir, const std::string& header);
+  // Throws std::runtime_error if an existing summary has a different header.
+  static void append_summary(const std::string& out_dir, const std::string& header, const std::vector<std::string>& rows);
+  int shard_of_cs(int cs_id) const;
+  SimTime lookahead_us() const;
+  SimTime glt_lead_us() const; // see LockTables
 };
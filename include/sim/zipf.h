@@ -1,12 +1,17 @@
 #pragma once
+#include "sim/types.h"
 #include <cstdint>
 #include <vector>
 #include <algorithm>
 #include <cmath>
+#include <memory>
+#include <random>
 
-struct Zipf {
+// Dense-CDF Zipf sampler (the original one). O(n) memory and setup; kept as
+// the reference distribution and for reproducing legacy key streams.
+struct ZipfCdf {
   std::uint64_t n; double s; std::vector<double> cdf;
-  Zipf(std::uint64_t n_, double s_) : n(n_), s(s_) {
+  ZipfCdf(std::uint64_t n_, double s_) : n(n_), s(s_) {
     if (n==0) n=1;
     std::vector<double> w(n);
     for (std::uint64_t i=1;i<=n;i++) w[i-1]=1.0/std::pow((double)i, s>0? s:0.0001);
@@ -14,5 +19,72 @@ struct Zipf {
     double run=0; cdf.resize(n);
     for (std::uint64_t i=0;i<n;i++){ run += w[i]/sum; cdf[i]=run; }
   }
-  std::uint64_t sample(double u) const { auto it = std::lower_bound(cdf.begin(), cdf.end(), u); return (std::uint64_t)std::distance(cdf.begin(), it); }
+  std::uint64_t sample(double u) const { auto it = std::lower_bound(cdf.begin(), cdf.end(), u); return std::min<std::uint64_t>((std::uint64_t)std::distance(cdf.begin(), it), n-1); }
+};
+
+// Constant-memory Zipf over ranks [0, n): rejection-inversion (Hörmann &
+// Derflinger 1996), ~1.1 uniforms per sample for any n and s > 0; s <= 0 is
+// uniform. Rank 0 is the hottest. With scramble, ranks are mapped through a
+// bijection of [0, n) so hot keys spread over the keyspace (and the tree)
+// instead of clustering at its low end.
+struct Zipf {
+  std::uint64_t n; double s; bool scramble;
+
+  Zipf(std::uint64_t n_, double s_, bool scramble_ = false, ZipfSampler kind = ZipfSampler::RejectionInversion)
+    : n(n_ ? n_ : 1), s(s_), scramble(scramble_) {
+    if (kind == ZipfSampler::Cdf) dense = std::make_unique<ZipfCdf>(n, s);
+    if (s > 0){
+      h_int_x1 = h_integral(1.5) - 1.0;
+      h_int_n = h_integral(double(n) + 0.5);
+      shortcut = 2.0 - h_integral_inv(h_integral(2.5) - h(2.0));
+    }
+    bits = 1; while (bits < 64 && (std::uint64_t(1) << bits) < n) ++bits;
+    mask = bits >= 64 ? ~0ull : (std::uint64_t(1) << bits) - 1;
+  }
+
+  template<class RNG> std::uint64_t sample(RNG& rng) const {
+    std::uniform_real_distribution<double> U(0.0, 1.0);
+    std::uint64_t r;
+    if (dense) r = dense->sample(U(rng));
+    else if (s <= 0) r = std::min<std::uint64_t>(static_cast<std::uint64_t>(U(rng) * double(n)), n - 1);
+    else r = sample_ri(rng, U);
+    return scramble ? permute(r) : r;
+  }
+
+  // Bijection on [0, n): xorshift-multiply rounds on the enclosing power of
+  // two, cycle-walked back into range (< 2 rounds on average).
+  std::uint64_t permute(std::uint64_t x) const {
+    do {
+      for (int round = 0; round < 3; ++round){
+        x ^= x >> ((bits + 1) / 2);
+        x = (x * 0x9e3779b97f4a7c15ull + 0x632be59bd9b4e019ull) & mask;
+      }
+    } while (x >= n);
+    return x;
+  }
+
+private:
+  std::unique_ptr<ZipfCdf> dense;
+  double h_int_x1{0}, h_int_n{0}, shortcut{0};
+  int bits{1}; std::uint64_t mask{1};
+
+  template<class RNG> std::uint64_t sample_ri(RNG& rng, std::uniform_real_distribution<double>& U) const {
+    while (true){
+      const double u = h_int_n + U(rng) * (h_int_x1 - h_int_n);
+      const double x = h_integral_inv(u);
+      double k = std::floor(x + 0.5);
+      if (k < 1) k = 1; else if (k > double(n)) k = double(n);
+      if (k - x <= shortcut || u >= h_integral(k + 0.5) - h(k)) return static_cast<std::uint64_t>(k) - 1;
+    }
+  }
+  // H(x) = integral of x^-s, written to stay accurate as s -> 1
+  double h_integral(double x) const { const double lx = std::log(x); return helper2((1.0 - s) * lx) * lx; }
+  double h(double x) const { return std::exp(-s * std::log(x)); }
+  double h_integral_inv(double x) const {
+    double t = x * (1.0 - s);
+    if (t < -1.0) t = -1.0;
+    return std::exp(helper1(t) * x);
+  }
+  static double helper1(double x){ return std::abs(x) > 1e-8 ? std::log1p(x) / x : 1.0 - x * (0.5 - x * (1.0/3.0 - 0.25 * x)); }
+  static double helper2(double x){ return std::abs(x) > 1e-8 ? std::expm1(x) / x : 1.0 + x * 0.5 * (1.0 + x * (1.0/3.0) * (1.0 + 0.25 * x)); }
 };
@@ -1,6 +1,10 @@
-# Usage: python3 scripts/plot_ablation_series.py
-# Plots and compares all ablation metrics in one go.
+# Usage: python3 scripts/plot_ablation_series.py [merged_metrics_summary.csv]
+# Plots and compares all ablation metrics in one go. With no argument, reads the
+# per-ablation out dirs below; with a merged summary (sim --out DIR cfg...), the
+# `scenario` column labels each ablation.
 import os
+import re
+import sys
 import pandas as pd
 import matplotlib.pyplot as plt
 
@@ -13,18 +17,22 @@ ABLATION_DIRS = [
 ]
 
 # Collect all data
-all_data = []
-for label, path in ABLATION_DIRS:
-    if os.path.exists(path):
-        df = pd.read_csv(path)
-        df['ablation'] = label
-        all_data.append(df)
-    else:
-        print(f"Warning: {path} not found, skipping.")
+if len(sys.argv) > 1:
+    df_all = pd.read_csv(sys.argv[1])
+    df_all['ablation'] = df_all['scenario']
+else:
+    all_data = []
+    for label, path in ABLATION_DIRS:
+        if os.path.exists(path):
+            df = pd.read_csv(path)
+            df['ablation'] = label
+            all_data.append(df)
+        else:
+            print(f"Warning: {path} not found, skipping.")
+    df_all = pd.concat(all_data, ignore_index=True)
 
-df_all = pd.concat(all_data, ignore_index=True)
-
-# For each workload, plot throughput and p99 across ablations
+# For each workload, plot throughput and every latency percentile across ablations
+PTILES = sorted((c for c in df_all.columns if re.fullmatch(r'p[0-9.]+_us', c)), key=lambda c: float(c[1:-3]))
 
 # Ensure output directories exist
 os.makedirs("results", exist_ok=True)
@@ -32,23 +40,27 @@ os.makedirs("results", exist_ok=True)
 
 for wl in df_all['workload'].unique():
     g = df_all[df_all['workload'] == wl].copy()
-    # Throughput: ops / (p99_us / 1e6) = ops/sec
-    g['throughput_ops_sec'] = g['ops'] / (g['p99_us'] / 1e6)
-
+    # achieved throughput (completed ops over sim time) next to the offered load
+    pos = range(len(g))
     plt.figure()
-    plt.bar(g['ablation'], g['throughput_ops_sec'])
+    plt.bar([i - 0.2 for i in pos], g['offered_ops_s'], width=0.4, label='offered')
+    plt.bar([i + 0.2 for i in pos], g['throughput_ops_s'], width=0.4, label='achieved')
+    plt.xticks(list(pos), g['ablation'])
     plt.title(f"Throughput (ops/sec) — {wl}")
     plt.ylabel('ops/sec')
+    plt.legend()
     plt.tight_layout()
     plt.savefig(os.path.join("results", f"{wl}_throughput_ablation.png"), dpi=150)
     plt.close()
 
-    plt.figure()
-    plt.bar(g['ablation'], g['p99_us'])
-    plt.title(f"p99 latency (us) — {wl}")
-    plt.ylabel('microseconds')
-    plt.tight_layout()
-    plt.savefig(os.path.join("results", f"{wl}_p99_ablation.png"), dpi=150)
-    plt.close()
+    for col in PTILES:
+        p = col[:-3]
+        plt.figure()
+        plt.bar(g['ablation'], g[col])
+        plt.title(f"{p} latency (us) — {wl}")
+        plt.ylabel('microseconds')
+        plt.tight_layout()
+        plt.savefig(os.path.join("results", f"{wl}_{p}_ablation.png"), dpi=150)
+        plt.close()
 
 print("Wrote ablation comparison PNGs for each workload.")
@@ -1,5 +1,10 @@
 # Usage: python3 scripts/plot_metrics.py out/metrics_summary.csv
-import sys, pandas as pd, matplotlib.pyplot as plt
+import sys, glob, os, re, pandas as pd, matplotlib.pyplot as plt
+
+def ptile_cols(df):
+    """`p<P>_us` latency columns (metrics.ptiles), lowest percentile first."""
+    cols = [c for c in df.columns if re.fullmatch(r'p[0-9.]+_us', c)]
+    return sorted(cols, key=lambda c: float(c[1:-3]))
 
 if len(sys.argv)<2:
     print("usage: plot_metrics.py out/metrics_summary.csv"); sys.exit(1)
@@ -9,17 +14,42 @@ for wl, g in df.groupby('workload'):
     fig = plt.figure()
     ax = fig.add_subplot(111)
     x = g['index']
-    ax.bar(x, g['ops'])
-    ax.set_title(f"Throughput (ops) — {wl}")
-    ax.set_ylabel('ops completed')
+    pos = range(len(g))
+    ax.bar([i - 0.2 for i in pos], g['offered_ops_s'], width=0.4, label='offered')
+    ax.bar([i + 0.2 for i in pos], g['throughput_ops_s'], width=0.4, label='achieved')
+    ax.set_xticks(list(pos))
+    ax.set_xticklabels(x)
+    ax.set_title(f"Throughput (ops/s) — {wl}")
+    ax.set_ylabel('ops/s')
+    ax.legend()
     fig.tight_layout()
     fig.savefig(f"{wl}_throughput.png", dpi=150)
 
-    fig2 = plt.figure()
-    ax2 = fig2.add_subplot(111)
-    ax2.bar(x, g['p99_us'])
-    ax2.set_title(f"p99 latency (us) — {wl}")
-    ax2.set_ylabel('microseconds')
-    fig2.tight_layout()
-    fig2.savefig(f"{wl}_p99.png", dpi=150)
+    for col in ptile_cols(g):
+        p = col[:-3]
+        fig2 = plt.figure()
+        ax2 = fig2.add_subplot(111)
+        ax2.bar(x, g[col])
+        ax2.set_title(f"{p} latency (us) — {wl}")
+        ax2.set_ylabel('microseconds')
+        fig2.tight_layout()
+        fig2.savefig(f"{wl}_{p}.png", dpi=150)
+
+# per-window series (metrics.window_us > 0): throughput and the highest percentile over sim time
+for path in sorted(glob.glob(os.path.join(os.path.dirname(sys.argv[1]) or '.', 'timeseries_*.csv'))):
+    ts = pd.read_csv(path)
+    name = os.path.splitext(os.path.basename(path))[0]
+    fig3 = plt.figure()
+    ax3 = fig3.add_subplot(111)
+    ax3.plot(ts['start_us'], ts['throughput_ops_s'], color='tab:blue')
+    ax3.set_xlabel('sim time (us)')
+    ax3.set_ylabel('ops/s', color='tab:blue')
+    tail = ptile_cols(ts)
+    if tail:
+        ax4 = ax3.twinx()
+        ax4.plot(ts['start_us'], ts[tail[-1]], color='tab:red')
+        ax4.set_ylabel(f"{tail[-1][:-3]} (us)", color='tab:red')
+    ax3.set_title(name)
+    fig3.tight_layout()
+    fig3.savefig(f"{name}.png", dpi=150)
 print("wrote *png files next to metrics_summary.csv")
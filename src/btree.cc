@@ -0,0 +1,144 @@
+#include "sim/btree.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+BTreeModel::BTreeModel(std::uint64_t keyspace_, std::size_t node_bytes, std::size_t internal_entry_bytes,
+                       int leaf_capacity, double fill)
+  : keyspace(std::max<std::uint64_t>(1, keyspace_)),
+    leaf_cap(std::max(2, leaf_capacity)),
+    fan(std::max(3, (int)(node_bytes / std::max<std::size_t>(1, internal_entry_bytes)))) {
+  fill = std::clamp(fill, 0.01, 1.0);
+  per_leaf = std::max<std::uint64_t>(1, (std::uint64_t)std::floor(leaf_cap * fill));
+  per_internal = std::max<std::uint64_t>(2, (std::uint64_t)std::floor(fan * fill));
+
+  // Bulk load bottom-up until one node remains.
+  const std::uint64_t nleaves = (keyspace + per_leaf - 1) / per_leaf;
+  levels.push_back(Level{per_leaf, nleaves, nleaves, {}, {}});
+  while (levels.back().bulk > 1){
+    const Level& c = levels.back();
+    const std::uint64_t span = c.span > std::numeric_limits<std::uint64_t>::max() / per_internal
+                             ? std::numeric_limits<std::uint64_t>::max() : c.span * per_internal;
+    const std::uint64_t bulk = (c.bulk + per_internal - 1) / per_internal;
+    levels.push_back(Level{span, bulk, bulk, {}, {}});
+  }
+}
+
+// The covering node is the bulk node of the key unless a split-created node
+// starts inside that bulk node's range at or below the key.
+std::uint64_t BTreeModel::find(int level, std::uint64_t key) const {
+  const Level& l = levels[level];
+  const std::uint64_t b = l.span ? std::min(key / l.span, l.bulk - 1) : 0;
+  if (!l.fences.empty()){
+    auto it = l.fences.upper_bound(key);
+    if (it != l.fences.begin() && (--it)->first >= b * l.span) return it->second;
+  }
+  return b;
+}
+
+BTreeModel::Node BTreeModel::peek(int level, std::uint64_t idx) const {
+  const Level& l = levels[level];
+  auto it = l.nodes.find(idx);
+  if (it != l.nodes.end()) return it->second;
+  // not materialized yet, so still a bulk node
+  const std::uint64_t lo = idx * l.span;
+  const std::uint64_t hi = (idx + 1 == l.bulk) ? keyspace : lo + l.span;
+  const std::uint64_t entries = level == 0 ? hi - lo
+                              : std::min(per_internal, levels[level - 1].bulk - idx * per_internal);
+  return Node{lo, hi, (int)entries, 0};
+}
+
+BTreeModel::Node& BTreeModel::node(int level, std::uint64_t idx){
+  auto& nodes = levels[level].nodes;
+  auto it = nodes.find(idx);
+  if (it != nodes.end()) return it->second;
+  return nodes.emplace(idx, peek(level, idx)).first->second;
+}
+
+// Split a node at the midpoint of its key range and push a separator into the
+// parent. Separators follow key ranges rather than child boundaries; that is
+// enough for path lengths, occupancy and per-level footprint.
+bool BTreeModel::split(int level, std::uint64_t idx, Split& out){
+  Node& n = node(level, idx);
+  if (n.hi - n.lo < 2) return false;
+  const std::uint64_t mid = n.lo + (n.hi - n.lo) / 2;
+  const int moved = n.entries / 2;
+  Level& l = levels[level];
+  const std::uint64_t sib = l.next++;
+  l.nodes.emplace(sib, Node{mid, n.hi, moved, 0});
+  n.hi = mid; n.entries -= moved; n.version++;
+  l.fences.emplace(mid, sib);
+  ++n_splits;
+  if (level == 0) out.sibling = id_of(0, sib); else ++out.internal_splits;
+
+  if (level + 1 == (int)levels.size()){
+    levels.push_back(Level{0, 1, 1, {}, {}});
+    levels.back().nodes.emplace(0, Node{0, keyspace, 2, 0});
+    out.new_root = true;
+    return true;
+  }
+  const std::uint64_t p = find(level + 1, mid);
+  Node& parent = node(level + 1, p);
+  parent.version++;
+  if (++parent.entries >= fan) split(level + 1, p, out);
+  return true;
+}
+
+BTreeModel::NodeId BTreeModel::path(std::uint64_t key, std::vector<NodeId>& nodes){
+  key = std::min(key, keyspace - 1);
+  nodes.resize(levels.size());
+  for (int lvl = (int)levels.size() - 1, d = 0; lvl >= 0; --lvl, ++d) nodes[d] = id_of(lvl, find(lvl, key));
+  return nodes.back();
+}
+
+void BTreeModel::leaves_in_range(std::uint64_t lo, std::uint64_t n, std::vector<NodeId>& out){
+  out.clear();
+  lo = std::min(lo, keyspace - 1);
+  const std::uint64_t end = lo + std::min(std::max<std::uint64_t>(n, 1), keyspace - lo);
+  for (std::uint64_t k = lo; k < end; ){
+    const std::uint64_t idx = find(0, k);
+    out.push_back(id_of(0, idx));
+    k = peek(0, idx).hi;
+  }
+}
+
+BTreeModel::Split BTreeModel::insert(NodeId leaf, double threshold, int shard, double at, SplitFn later){
+  if (pending.empty()) return add(leaf, threshold);
+  pending[shard].push_back(Insert{at, leaf, threshold, std::move(later)});
+  return {};
+}
+
+// Barrier step: the window's inserts in time order, ties by shard and then by
+// call; split follow-ups start when the next window opens.
+void BTreeModel::apply(Pdes& pdes){
+  std::vector<std::pair<int, Insert*>> all;
+  for (int s = 0; s < (int)pending.size(); ++s)
+    for (auto& in : pending[s]) all.emplace_back(s, &in);
+  std::stable_sort(all.begin(), all.end(), [](const auto& a, const auto& b){ return a.second->at < b.second->at; });
+  for (auto& [s, in] : all){
+    const Split split = add(in->leaf, in->threshold);
+    if (split.sibling != kNone && in->later)
+      pdes.loop(s).at(pdes.window_end(), [later = std::move(in->later), split]{ later(split); });
+  }
+  for (auto& p : pending) p.clear();
+}
+
+BTreeModel::Split BTreeModel::add(NodeId leaf, double threshold){
+  Split out;
+  const std::uint64_t idx = leaf & ((NodeId(1) << 56) - 1);
+  Node& n = node(0, idx);
+  n.entries = std::min(leaf_cap, n.entries + 1);
+  if (threshold <= 1.0 && n.entries >= (int)(threshold * leaf_cap)) split(0, idx, out);
+  return out;
+}
+
+std::uint32_t BTreeModel::version(NodeId id){
+  const int lvl = level_of(id);
+  if (lvl >= (int)levels.size()) return 0;
+  auto it = levels[lvl].nodes.find(id & ((NodeId(1) << 56) - 1));
+  return it == levels[lvl].nodes.end() ? 0 : it->second.version;
+}
+
+int BTreeModel::height(){ return (int)levels.size(); }
+std::uint64_t BTreeModel::leaves(){ return levels[0].next; }
+std::uint64_t BTreeModel::splits(){ return n_splits; }
@@ -1,2 +1,358 @@
 #include "sim/cache.h"
-// (All inline in header for this simple LRU.)
+#include <algorithm>
+#include <deque>
+#include <unordered_map>
+
+namespace {
+
+constexpr std::uint32_t kNone = CachePolicy::kNone;
+
+// Intrusive doubly-linked lists over entry indices; an entry is on at most
+// one list of a policy at a time.
+struct Links {
+  struct Node { std::uint32_t prev{kNone}, next{kNone}; };
+  std::vector<Node> n;
+  void ensure(std::uint32_t e){ if (e >= n.size()) n.resize(e + 1); }
+  std::size_t host_bytes() const { return n.capacity() * sizeof(Node); }
+};
+
+struct List {
+  std::uint32_t head{kNone}, tail{kNone};
+  std::size_t bytes{0};
+  bool empty() const { return head == kNone; }
+  void push_front(Links& l, std::uint32_t e, std::size_t b){
+    l.ensure(e);
+    l.n[e] = {kNone, head};
+    if (head != kNone) l.n[head].prev = e; else tail = e;
+    head = e; bytes += b;
+  }
+  void unlink(Links& l, std::uint32_t e, std::size_t b){
+    auto& x = l.n[e];
+    if (x.prev != kNone) l.n[x.prev].next = x.next; else head = x.next;
+    if (x.next != kNone) l.n[x.next].prev = x.prev; else tail = x.prev;
+    bytes -= b;
+  }
+};
+
+// Per-entry bytes and list membership, shared by the list-based policies.
+struct Meta {
+  std::vector<std::uint32_t> bytes;
+  std::vector<std::uint8_t> where, freq;
+  void ensure(std::uint32_t e){
+    if (e >= bytes.size()){ bytes.resize(e + 1, 0); where.resize(e + 1, 0); freq.resize(e + 1, 0); }
+  }
+  std::size_t host_bytes() const { return bytes.capacity() * 4 + where.capacity() + freq.capacity(); }
+};
+
+class Lru final : public CachePolicy {
+  Links links; List order; Meta meta;
+public:
+  void insert(std::uint32_t e, std::uint64_t, std::size_t b) override {
+    meta.ensure(e); meta.bytes[e] = (std::uint32_t)b; order.push_front(links, e, b);
+  }
+  void hit(std::uint32_t e) override {
+    if (order.head == e) return;
+    order.unlink(links, e, meta.bytes[e]); order.push_front(links, e, meta.bytes[e]);
+  }
+  std::uint32_t victim() override { return order.tail; }
+  void erase(std::uint32_t e) override { order.unlink(links, e, meta.bytes[e]); }
+  std::size_t host_bytes() const override { return links.host_bytes() + meta.host_bytes(); }
+};
+
+// Second chance: a hand sweeps a ring of entries, clearing reference bits
+// until it finds an unreferenced one.
+class Clock final : public CachePolicy {
+  std::vector<std::uint32_t> ring, holes;
+  std::vector<std::uint32_t> pos;
+  std::vector<std::uint8_t> ref;
+  std::size_t hand{0};
+public:
+  void insert(std::uint32_t e, std::uint64_t, std::size_t) override {
+    if (e >= pos.size()){ pos.resize(e + 1, kNone); ref.resize(e + 1, 0); }
+    ref[e] = 0;
+    if (!holes.empty()){ pos[e] = holes.back(); holes.pop_back(); ring[pos[e]] = e; }
+    else { pos[e] = (std::uint32_t)ring.size(); ring.push_back(e); }
+  }
+  void hit(std::uint32_t e) override { ref[e] = 1; }
+  std::uint32_t victim() override {
+    if (holes.size() == ring.size()) return kNone;
+    for (;; hand = (hand + 1) % ring.size()){
+      const std::uint32_t e = ring[hand];
+      if (e == kNone) continue;
+      if (!ref[e]) return e;
+      ref[e] = 0;
+    }
+  }
+  void erase(std::uint32_t e) override { ring[pos[e]] = kNone; holes.push_back(pos[e]); pos[e] = kNone; }
+  std::size_t host_bytes() const override {
+    return (ring.capacity() + holes.capacity() + pos.capacity()) * 4 + ref.capacity();
+  }
+};
+
+// S3-FIFO (Yang et al., SOSP'23): new entries go to a small FIFO (10% of the
+// bytes); ones hit again there move to the main FIFO, the rest leave and are
+// remembered in a ghost FIFO so a quick return goes straight to main. Main
+// reinserts entries with a non-zero (2-bit) frequency, decrementing it.
+class S3Fifo final : public CachePolicy {
+  enum : std::uint8_t { kOut, kSmall, kMain };
+  Links links; List small, main; Meta meta;
+  std::vector<std::uint64_t> key;
+  std::deque<std::uint64_t> ghost;
+  std::unordered_map<std::uint64_t, std::uint32_t> in_ghost;
+  std::size_t small_cap, live{0};
+
+  void remember(std::uint64_t h){
+    ghost.push_back(h); in_ghost[h]++;
+    while (ghost.size() > std::max<std::size_t>(live, 1)){
+      auto it = in_ghost.find(ghost.front());
+      if (--it->second == 0) in_ghost.erase(it);
+      ghost.pop_front();
+    }
+  }
+public:
+  explicit S3Fifo(std::size_t cap) : small_cap(std::max<std::size_t>(1, cap / 10)) {}
+  void insert(std::uint32_t e, std::uint64_t h, std::size_t b) override {
+    meta.ensure(e); if (e >= key.size()) key.resize(e + 1);
+    meta.bytes[e] = (std::uint32_t)b; meta.freq[e] = 0; key[e] = h; ++live;
+    if (in_ghost.count(h)){ meta.where[e] = kMain; main.push_front(links, e, b); }
+    else { meta.where[e] = kSmall; small.push_front(links, e, b); }
+  }
+  void hit(std::uint32_t e) override { meta.freq[e] = std::min<std::uint8_t>(3, meta.freq[e] + 1); }
+  std::uint32_t victim() override {
+    for (;;){
+      if (!small.empty() && (small.bytes > small_cap || main.empty())){
+        const std::uint32_t e = small.tail;
+        small.unlink(links, e, meta.bytes[e]);
+        if (meta.freq[e] > 0){ meta.freq[e] = 0; meta.where[e] = kMain; main.push_front(links, e, meta.bytes[e]); continue; }
+        meta.where[e] = kOut; remember(key[e]);
+        return e;
+      }
+      if (main.empty()) return kNone;
+      const std::uint32_t e = main.tail;
+      main.unlink(links, e, meta.bytes[e]);
+      if (meta.freq[e] > 0){ meta.freq[e]--; main.push_front(links, e, meta.bytes[e]); continue; }
+      meta.where[e] = kOut;
+      return e;
+    }
+  }
+  void erase(std::uint32_t e) override {
+    if (meta.where[e] == kSmall) small.unlink(links, e, meta.bytes[e]);
+    else if (meta.where[e] == kMain) main.unlink(links, e, meta.bytes[e]);
+    meta.where[e] = kOut; --live;
+  }
+  std::size_t host_bytes() const override {
+    return links.host_bytes() + meta.host_bytes() + key.capacity() * 8 + ghost.size() * 8
+         + in_ghost.size() * (sizeof(std::uint64_t) + sizeof(std::uint32_t) + 2 * sizeof(void*));
+  }
+};
+
+// W-TinyLFU (Einziger et al.): a 1% LRU window in front of a segmented LRU
+// main area (20% probation, 80% protected). An entry leaving the window gets
+// into main only if a count-min sketch of recent accesses rates it above
+// main's eviction candidate. Sketch counters are 4 rows of 8 bits (saturating
+// at 15) and are halved every 10 * width accesses; width starts at the number
+// of nodes the cache holds and only doubles (keeping every counter) if more
+// entries show up.
+class TinyLfu final : public CachePolicy {
+  enum : std::uint8_t { kOut, kWindow, kProbation, kProtected };
+  Links links; List window, probation, prot; Meta meta;
+  std::vector<std::uint64_t> key;
+  std::vector<std::uint8_t> sketch;       // 4 rows of `width`
+  std::size_t width{1024}, additions{0};
+  std::size_t window_cap, protected_cap;
+
+  std::size_t cell(std::uint64_t h, int row) const {
+    std::uint64_t x = h * (0x9e3779b97f4a7c15ull + 2 * row) + row;
+    return row * width + std::size_t(x >> 40) % width;
+  }
+  int estimate(std::uint64_t h) const {
+    int f = 255;
+    for (int r = 0; r < 4; ++r) f = std::min<int>(f, sketch[cell(h, r)]);
+    return f;
+  }
+  void move(std::uint32_t e, List& from, List& to, std::uint8_t w){
+    from.unlink(links, e, meta.bytes[e]); to.push_front(links, e, meta.bytes[e]); meta.where[e] = w;
+  }
+  // With power-of-two widths a hash's column in the wider table is its old
+  // column or a copy of it, so replicating each row keeps every estimate.
+  void grow(std::size_t want){
+    std::vector<std::uint8_t> wider(4 * want);
+    for (std::size_t r = 0; r < 4; ++r)
+      for (std::size_t c = 0; c < want; ++c) wider[r * want + c] = sketch[r * width + c % width];
+    sketch.swap(wider);
+    width = want;
+  }
+public:
+  TinyLfu(std::size_t cap, std::size_t node_bytes)
+    : window_cap(std::max<std::size_t>(1, cap / 100)), protected_cap((cap - cap / 100) * 8 / 10) {
+    for (const std::size_t nodes = cap / std::max<std::size_t>(1, node_bytes); width < nodes; ) width *= 2;
+    sketch.assign(4 * width, 0);
+  }
+  void access(std::uint64_t h) override {
+    for (int r = 0; r < 4; ++r){ auto& c = sketch[cell(h, r)]; if (c < 15) ++c; }
+    if (++additions >= 10 * width){
+      for (auto& c : sketch) c >>= 1;
+      additions /= 2;
+    }
+  }
+  void insert(std::uint32_t e, std::uint64_t h, std::size_t b) override {
+    meta.ensure(e); if (e >= key.size()) key.resize(e + 1);
+    meta.bytes[e] = (std::uint32_t)b; key[e] = h; meta.where[e] = kWindow;
+    window.push_front(links, e, b);
+    // while the cache fills, window overflow enters main freely
+    while (window.bytes > window_cap && window.tail != e) move(window.tail, window, probation, kProbation);
+    // entries smaller than a node can outnumber the sketch
+    if (key.size() > width){
+      std::size_t want = width;
+      while (want < key.size()) want *= 2;
+      grow(want);
+    }
+  }
+  void hit(std::uint32_t e) override {
+    switch (meta.where[e]){
+      case kWindow: move(e, window, window, kWindow); break;
+      case kProtected: move(e, prot, prot, kProtected); break;
+      case kProbation:
+        move(e, probation, prot, kProtected);
+        while (prot.bytes > protected_cap && prot.tail != e) move(prot.tail, prot, probation, kProbation);
+        break;
+    }
+  }
+  std::uint32_t victim() override {
+    // a full window pushes its oldest entry out: it replaces main's victim
+    // only if it is accessed more often
+    if (window.bytes >= window_cap && !window.empty()){
+      const std::uint32_t cand = window.tail;
+      const std::uint32_t vic = !probation.empty() ? probation.tail : prot.tail;
+      if (vic == kNone) return cand;
+      if (estimate(key[cand]) > estimate(key[vic])){ move(cand, window, probation, kProbation); return vic; }
+      return cand;
+    }
+    if (!probation.empty()) return probation.tail;
+    if (!prot.empty()) return prot.tail;
+    return window.tail;
+  }
+  void erase(std::uint32_t e) override {
+    switch (meta.where[e]){
+      case kWindow: window.unlink(links, e, meta.bytes[e]); break;
+      case kProbation: probation.unlink(links, e, meta.bytes[e]); break;
+      case kProtected: prot.unlink(links, e, meta.bytes[e]); break;
+    }
+    meta.where[e] = kOut;
+  }
+  std::size_t host_bytes() const override {
+    return links.host_bytes() + meta.host_bytes() + key.capacity() * 8 + sketch.capacity();
+  }
+};
+
+} // namespace
+
+std::unique_ptr<CachePolicy> make_cache_policy(CachePolicyKind kind, std::size_t cap_bytes, std::size_t node_bytes){
+  switch (kind){
+    case CachePolicyKind::Clock:   return std::make_unique<Clock>();
+    case CachePolicyKind::S3Fifo:  return std::make_unique<S3Fifo>(cap_bytes);
+    case CachePolicyKind::TinyLfu: return std::make_unique<TinyLfu>(cap_bytes, node_bytes);
+    default:                       return std::make_unique<Lru>();
+  }
+}
+
+NodeCache::NodeCache(std::size_t cap, CachePolicyKind kind, int pin, std::size_t node_bytes)
+  : cap_bytes(cap), pin_levels(pin), policy(make_cache_policy(kind, cap, node_bytes)), table(64, kNil) {}
+
+std::uint64_t NodeCache::hash(std::uint64_t node, int level){
+  std::uint64_t x = node ^ (std::uint64_t(level) << 58);
+  x ^= x >> 33; x *= 0xff51afd7ed558ccdull; x ^= x >> 33;
+  return x;
+}
+
+std::size_t NodeCache::find(CacheKey k) const {
+  const std::size_t mask = table.size() - 1;
+  for (std::size_t i = home(k.node_id, k.level); table[i] != kNil; i = (i + 1) & mask){
+    const Entry& e = entries[table[i]];
+    if (e.node == k.node_id && e.level == k.level) return i;
+  }
+  return table.size();
+}
+
+void NodeCache::grow(){
+  std::vector<std::uint32_t> old(table.size() * 2, kNil);
+  old.swap(table);
+  const std::size_t mask = table.size() - 1;
+  for (std::uint32_t idx : old){
+    if (idx == kNil) continue;
+    std::size_t i = home(entries[idx].node, entries[idx].level);
+    while (table[i] != kNil) i = (i + 1) & mask;
+    table[i] = idx;
+  }
+}
+
+// Drop entry e; backward-shift deletion keeps probe runs intact without tombstones.
+void NodeCache::evict(std::uint32_t e){
+  const std::size_t mask = table.size() - 1;
+  std::size_t i = find({entries[e].node, entries[e].level});
+  for (std::size_t j = (i + 1) & mask; table[j] != kNil; j = (j + 1) & mask){
+    const std::size_t h = home(entries[table[j]].node, entries[table[j]].level);
+    // move j back into the hole unless its home lies cyclically in (i, j]
+    if (((j - h) & mask) >= ((j - i) & mask)){ table[i] = table[j]; i = j; }
+  }
+  table[i] = kNil;
+  policy->erase(e);
+  LevelStats& s = level(entries[e].level);
+  s.entries--; s.bytes -= entries[e].bytes;
+  cur_bytes -= entries[e].bytes; --live;
+  free_slots.push_back(e);
+}
+
+NodeCache::LevelStats& NodeCache::level(int l){
+  if ((std::size_t)l >= stats.size()) stats.resize(l + 1);
+  return stats[l];
+}
+
+bool NodeCache::get(CacheKey k, std::uint32_t* version){
+  policy->access(hash(k.node_id, k.level));
+  const std::size_t i = find(k);
+  if (i == table.size()){ level(k.level).misses++; return false; }
+  level(k.level).hits++;
+  if (version) *version = entries[table[i]].version;
+  if (k.level >= pin_levels) policy->hit(table[i]);
+  return true;
+}
+
+bool NodeCache::peek(CacheKey k, std::uint32_t* version) const {
+  const std::size_t i = find(k);
+  if (i == table.size()) return false;
+  if (version) *version = entries[table[i]].version;
+  return true;
+}
+
+void NodeCache::put(CacheKey k, std::size_t bytes, std::uint32_t version){
+  if (const std::size_t i = find(k); i != table.size()){
+    entries[table[i]].version = version;
+    if (k.level >= pin_levels) policy->hit(table[i]);
+    return;
+  }
+  while (cur_bytes + bytes > cap_bytes){
+    const std::uint32_t v = policy->victim();
+    if (v == CachePolicy::kNone) return; // only pinned nodes left
+    evict(v);
+  }
+  if ((live + 1) * 2 > table.size()) grow();
+
+  std::uint32_t e;
+  if (!free_slots.empty()){ e = free_slots.back(); free_slots.pop_back(); }
+  else { e = (std::uint32_t)entries.size(); entries.emplace_back(); }
+  entries[e] = Entry{k.node_id, k.level, (std::uint32_t)bytes, version};
+  std::size_t i = home(k.node_id, k.level);
+  while (table[i] != kNil) i = (i + 1) & (table.size() - 1);
+  table[i] = e;
+  if (k.level >= pin_levels) policy->insert(e, hash(k.node_id, k.level), bytes);
+  LevelStats& s = level(k.level);
+  s.entries++; s.bytes += bytes;
+  cur_bytes += bytes; ++live;
+}
+
+std::size_t NodeCache::host_bytes() const {
+  return sizeof(*this) + entries.capacity() * sizeof(Entry) + table.capacity() * sizeof(std::uint32_t)
+       + free_slots.capacity() * sizeof(std::uint32_t) + stats.capacity() * sizeof(LevelStats)
+       + policy->host_bytes();
+}
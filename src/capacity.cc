@@ -0,0 +1,73 @@
+#include "sim/capacity.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+SlotCalendar::SlotCalendar(double slot, double capacity_per_us)
+  : slot_us(slot), cap(std::max(1e-12, capacity_per_us * slot)) {}
+
+void SlotCalendar::prune(std::int64_t newest){
+  // forget slots far behind the newest arrival
+  while (!used.empty() && base + kKeepSlots < newest){ used.pop_front(); ++base; }
+  if (used.empty()) base = newest;
+}
+
+SimTime SlotCalendar::reserve(SimTime arrive, double amount, double min_us, int shard){
+  std::int64_t s = std::max<std::int64_t>(base, (std::int64_t)std::floor(arrive / slot_us));
+  SimTime finish = arrive;
+  if (!pending.empty()){
+    // committed slots are read-only until the barrier; this shard's own go aside
+    auto& mine = pending[shard];
+    while (amount > 0){
+      const std::size_t i = (std::size_t)(s - base);
+      const double committed = i < used.size() ? used[i] : 0.0;
+      double& own = mine[s];
+      const double take = std::min(cap - committed - own, amount);
+      if (take > 0){
+        own += take; amount -= take;
+        finish = std::max(finish, (double)s * slot_us + (committed + own) / cap * slot_us);
+      }
+      ++s;
+    }
+    return std::max(finish, arrive + min_us);
+  }
+  prune(s);
+  while (amount > 0){
+    const std::size_t i = (std::size_t)(s - base);
+    if (i >= used.size()) used.resize(i + 1, 0.0);
+    const double take = std::min(cap - used[i], amount);
+    if (take > 0){
+      used[i] += take; amount -= take;
+      finish = std::max(finish, (double)s * slot_us + used[i] / cap * slot_us);
+    }
+    ++s;
+  }
+  return std::max(finish, arrive + min_us);
+}
+
+void SlotCalendar::commit(){
+  std::int64_t lo = std::numeric_limits<std::int64_t>::max(), hi = std::numeric_limits<std::int64_t>::min();
+  for (const auto& p : pending)
+    for (const auto& [s, v] : p){ lo = std::min(lo, s); hi = std::max(hi, s); }
+  if (lo > hi) return;
+  if (used.empty()) base = lo;
+  // every pending slot is at or past base: reserve() starts there
+  for (std::size_t sh = 0; sh < pending.size(); ++sh){
+    auto& p = pending[sh];
+    for (const auto& [s, v] : p){
+      const std::size_t i = (std::size_t)(s - base);
+      if (i >= used.size()) used.resize(i + 1, 0.0);
+      used[i] += v;
+    }
+    p.clear();
+  }
+  // shards may have filled the same room: the excess spills into later slots
+  double carry = 0.0;
+  for (std::size_t i = (std::size_t)(lo - base); i < used.size() || carry > 0; ++i){
+    if (i >= used.size()) used.resize(i + 1, 0.0);
+    used[i] += carry;
+    carry = std::max(0.0, used[i] - cap);
+    used[i] -= carry;
+  }
+  prune(hi);
+}
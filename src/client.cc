@@ -0,0 +1,49 @@
+#include "sim/client.h"
+#include <algorithm>
+#include <cmath>
+
+ClientThread::ClientThread(EventLoop& l, Index& i, Metrics& mm, const WorkloadCfg& w, const Zipf& z, int g, int n,
+                           const trace::Reader* t)
+  : loop(l), idx(i), m(mm), wl(w), zipf(z), trace(t), gid(g), nthreads(n),
+    quota(w.ops / n + (std::uint64_t(g) < w.ops % n ? 1 : 0)),
+    rng(0x9e3779b97f4a7c15ull * std::uint64_t(g + 1) ^ 42) {}
+
+void ClientThread::start(){
+  if (wl.client.mode == ClientMode::Open){ schedule_arrival(); return; }
+  const int n = std::max(1, wl.client.outstanding);
+  for (int k = 0; k < n; ++k) loop.after(0, [this]{ issue(); });
+}
+
+void ClientThread::issue(){
+  if (issued >= quota) return;
+  const std::uint64_t op_id = issued++ * std::uint64_t(nthreads) + gid;
+  OpType op; std::uint64_t key;
+  if (trace){ const auto r = trace->at(op_id); op = r.op; key = r.key % wl.keyspace; }
+  else { op = wl.mix.pick(U(rng)); key = zipf.sample(rng); }
+  m.on_issue(loop.now);
+  if (op == OpType::Get) idx.get(key, m, op_id);
+  else if (op == OpType::Scan) idx.scan(key, wl.range_len, m, op_id);
+  else idx.put(key, m, op_id);
+}
+
+void ClientThread::schedule_arrival(){
+  if (issued >= quota) return;
+  if (trace && trace->has_arrivals()){
+    const SimTime t = trace->at(issued * std::uint64_t(nthreads) + gid).arrival_us;
+    loop.at(std::max(loop.now, t), [this]{ issue(); schedule_arrival(); });
+    return;
+  }
+  const double rate_us = std::max(1e-12, wl.client.rate_ops_per_s / 1e6 / nthreads);
+  const double gap = (wl.client.arrival == Arrival::Fixed)
+    ? 1.0 / rate_us
+    : -std::log(1.0 - U(rng)) / rate_us;
+  // first arrival of a fixed-rate stream is staggered by thread id
+  const double first = (wl.client.arrival == Arrival::Fixed) ? gap * gid / nthreads : gap;
+  loop.after(issued == 0 ? first : gap, [this]{ issue(); schedule_arrival(); });
+}
+
+void ClientThread::op_done(std::uint64_t, SimTime when){
+  if (wl.client.mode != ClientMode::Closed) return;
+  if (wl.client.think_us > 0) loop.at(when + wl.client.think_us, [this]{ issue(); });
+  else issue();
+}
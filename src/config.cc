@@ -1,9 +1,56 @@
 #include "sim/config.h"
 #include <yaml-cpp/yaml.h>
+#include <filesystem>
+#include <utility>
 
-SimConf LoadConfig(const std::string& path){
+namespace fs = std::filesystem;
+
+static ClientCfg LoadClient(const YAML::Node& n, ClientCfg c){
+  if (!n) return c;
+  std::string mode = n["mode"].as<std::string>(c.mode == ClientMode::Open ? "open" : c.mode == ClientMode::Batch ? "batch" : "closed");
+  c.mode = (mode == "open") ? ClientMode::Open : (mode == "batch") ? ClientMode::Batch : ClientMode::Closed;
+  c.outstanding = n["outstanding"].as<int>(c.outstanding);
+  c.think_us = n["think_us"].as<double>(c.think_us);
+  std::string arr = n["arrival"].as<std::string>(c.arrival == Arrival::Fixed ? "fixed" : "poisson");
+  c.arrival = (arr == "fixed") ? Arrival::Fixed : Arrival::Poisson;
+  c.rate_ops_per_s = n["rate_ops_per_s"].as<double>(c.rate_ops_per_s);
+  return c;
+}
+
+static CachePolicyKind LoadCachePolicy(const YAML::Node& n, CachePolicyKind d){
+  if (!n) return d;
+  const std::string p = n.as<std::string>();
+  return p == "clock" ? CachePolicyKind::Clock : p == "s3fifo" ? CachePolicyKind::S3Fifo
+       : p == "tinylfu" ? CachePolicyKind::TinyLfu : CachePolicyKind::LRU;
+}
+
+static SimConf LoadConfigNode(const YAML::Node& y){
   SimConf c;
-  auto y = YAML::LoadFile(path);
+
+  // engine
+  if (auto e = y["engine"]; e){
+    std::string q = e["event_queue"].as<std::string>("calendar");
+    c.engine.event_queue = (q == "heap") ? EventQueueKind::Heap : EventQueueKind::Calendar;
+    c.engine.workers = e["workers"].as<int>(c.engine.workers);
+    c.engine.lookahead_us = e["lookahead_us"].as<double>(c.engine.lookahead_us);
+  }
+
+  // cluster
+  if (auto cl = y["cluster"]; cl){
+    c.cluster.compute_nodes = cl["compute_nodes"].as<int>(c.cluster.compute_nodes);
+    c.cluster.memory_nodes = cl["memory_nodes"].as<int>(c.cluster.memory_nodes);
+    c.cluster.threads_per_compute = cl["threads_per_compute"].as<int>(c.cluster.threads_per_compute);
+    c.cluster.cs_cache_bytes = cl["cs_cache_bytes"].as<std::size_t>(c.cluster.cs_cache_bytes);
+    c.cluster.ms_cpu_cores = cl["ms_cpu_cores"].as<int>(c.cluster.ms_cpu_cores);
+  }
+
+  // memory server
+  if (auto ms = y["memory_server"]; ms){
+    c.mem.onchip_bytes = ms["rnic_onchip_bytes"].as<std::size_t>(c.mem.onchip_bytes);
+    c.mem.dram_lat_us = ms["dram_latency_us"].as<double>(c.mem.dram_lat_us);
+    c.mem.dram_bw_gbps = ms["dram_bw_gbps"].as<double>(c.mem.dram_bw_gbps);
+    c.mem.lock_bytes = ms["lock_bytes"].as<std::size_t>(c.mem.lock_bytes);
+  }
 
   // nic
   if (auto n = y["nic"]; n){
@@ -28,6 +75,32 @@ SimConf LoadConfig(const std::string& path){
     c.nic.pcie_desc_us = n["pcie_desc_us"].as<double>(c.nic.pcie_desc_us);
     c.nic.doorbell_batch_limit = n["doorbell_batch_limit"].as<int>(c.nic.doorbell_batch_limit);
     c.nic.sq_depth = n["sq_depth"].as<int>(c.nic.sq_depth);
+    c.nic.port_read_ops_per_s = n["port_read_ops_per_s"].as<double>(c.nic.port_read_ops_per_s);
+    c.nic.port_write_ops_per_s = n["port_write_ops_per_s"].as<double>(c.nic.port_write_ops_per_s);
+    c.nic.port_cas_ops_per_s = n["port_cas_ops_per_s"].as<double>(c.nic.port_cas_ops_per_s);
+  }
+
+  // index
+  if (auto ix = y["index"]; ix){
+    c.index.kind = (ix["kind"].as<std::string>("sherman") == "dex") ? IndexKind::DEX : IndexKind::Sherman;
+    c.index.node_bytes = ix["node_bytes"].as<std::size_t>(c.index.node_bytes);
+    c.index.leaf_entry_bytes = ix["leaf_entry_bytes"].as<std::size_t>(c.index.leaf_entry_bytes);
+    c.index.internal_entry_bytes = ix["internal_entry_bytes"].as<std::size_t>(c.index.internal_entry_bytes);
+    c.index.bulk_fill = ix["bulk_fill"].as<double>(c.index.bulk_fill);
+    if (auto ab = ix["ablations"]; ab){
+      auto& s = c.index.ablations.sherman;
+      if (auto n = ab["sherman"]){
+        s.disable_combine  = n["disable_combine"].as<bool>(s.disable_combine);
+        s.disable_hocl     = n["disable_hocl"].as<bool>(s.disable_hocl);
+        s.disable_versions = n["disable_versions"].as<bool>(s.disable_versions);
+      }
+      auto& d = c.index.ablations.dex;
+      if (auto n = ab["dex"]){
+        d.disable_partitioning = n["disable_partitioning"].as<bool>(d.disable_partitioning);
+        d.disable_path_cache   = n["disable_path_cache"].as<bool>(d.disable_path_cache);
+        d.disable_offload      = n["disable_offload"].as<bool>(d.disable_offload);
+      }
+    }
   }
 
   // sherman
@@ -38,10 +111,12 @@ SimConf LoadConfig(const std::string& path){
       c.index.sh.hocl.glt_slots = hocl["glt_slots"].as<int>(c.index.sh.hocl.glt_slots);
       c.index.sh.hocl.llt_enable= hocl["llt_enable"].as<bool>(c.index.sh.hocl.llt_enable);
       c.index.sh.hocl.llt_local_wait_us = hocl["llt_local_wait_us"].as<double>(c.index.sh.hocl.llt_local_wait_us);
+      c.index.sh.hocl.handover_depth = hocl["handover_depth"].as<int>(c.index.sh.hocl.handover_depth);
     }
     if (auto rdwc = sh["rdwc"]) {
       c.index.sh.rdwc.enable = rdwc["enable"].as<bool>(c.index.sh.rdwc.enable);
       c.index.sh.rdwc.window_us = rdwc["window_us"].as<double>(c.index.sh.rdwc.window_us);
+      c.index.sh.rdwc.slots = rdwc["slots"].as<int>(c.index.sh.rdwc.slots);
       std::string policy = rdwc["collision_policy"].as<std::string>("queue");
       c.index.sh.rdwc.collision_policy = (policy == "bypass") ? 
         ShermanConf::rdwc_t::CollisionPolicy::BYPASS : ShermanConf::rdwc_t::CollisionPolicy::QUEUE;
@@ -52,13 +127,14 @@ SimConf LoadConfig(const std::string& path){
       c.index.sh.hopscotch.slots_per_leaf = hop["slots_per_leaf"].as<int>(c.index.sh.hopscotch.slots_per_leaf);
       c.index.sh.hopscotch.enable_speculative = hop["enable_speculative"].as<bool>(c.index.sh.hopscotch.enable_speculative);
       c.index.sh.hopscotch.topK = hop["topK"].as<int>(c.index.sh.hopscotch.topK);
+      c.index.sh.hopscotch.budget_bytes = hop["budget_bytes"].as<std::size_t>(c.index.sh.hopscotch.budget_bytes);
       c.index.sh.hopscotch.rebuild_threshold = hop["rebuild_threshold"].as<double>(c.index.sh.hopscotch.rebuild_threshold);
     }
     c.index.sh.two_level_versioning = sh["two_level_versioning"].as<bool>(c.index.sh.two_level_versioning);
     c.index.sh.cache_levels = sh["cache_levels"].as<int>(c.index.sh.cache_levels);
+    c.index.sh.cache_policy = LoadCachePolicy(sh["cache_policy"], c.index.sh.cache_policy);
     // advanced
     c.index.sh.glt_hash_seed = sh["glt_hash_seed"].as<int>(c.index.sh.glt_hash_seed);
-    c.index.sh.cas_max_retries = sh["cas_max_retries"].as<int>(c.index.sh.cas_max_retries);
     c.index.sh.cas_backoff_us = sh["cas_backoff_us"].as<double>(c.index.sh.cas_backoff_us);
     c.index.sh.model_glt_collisions = sh["model_glt_collisions"].as<bool>(c.index.sh.model_glt_collisions);
     c.index.sh.leaf_max_entries = sh["leaf_max_entries"].as<int>(c.index.sh.leaf_max_entries);
@@ -68,20 +144,45 @@ SimConf LoadConfig(const std::string& path){
     c.index.sh.enable_merges = sh["enable_merges"].as<bool>(c.index.sh.enable_merges);
   }
 
-  // workloads
+  // dex
+  if (auto dx = y["dex"]; dx){
+    c.index.dx.logical_partitioning = dx["logical_partitioning"].as<bool>(c.index.dx.logical_partitioning);
+    c.index.dx.path_aware_cache = dx["path_aware_cache"].as<bool>(c.index.dx.path_aware_cache);
+    if (auto off = dx["offload"]){
+      c.index.dx.offload.enable = off["enable"].as<bool>(c.index.dx.offload.enable);
+      c.index.dx.offload.ms_cpu_budget_ops_per_s = off["ms_cpu_budget_ops_per_s"].as<double>(c.index.dx.offload.ms_cpu_budget_ops_per_s);
+    }
+    c.index.dx.num_partitions = dx["num_partitions"].as<int>(c.index.dx.num_partitions);
+    c.index.dx.repartition_period_ms = dx["repartition_period_ms"].as<double>(c.index.dx.repartition_period_ms);
+    c.index.dx.repartition_topK = dx["repartition_topK"].as<int>(c.index.dx.repartition_topK);
+    c.index.dx.remap_broadcast_us = dx["remap_broadcast_us"].as<double>(c.index.dx.remap_broadcast_us);
+    c.index.dx.cache_inval_prob = dx["cache_inval_prob"].as<double>(c.index.dx.cache_inval_prob);
+    c.index.dx.cache_levels = dx["cache_levels"].as<int>(c.index.dx.cache_levels);
+    c.index.dx.cache_policy = LoadCachePolicy(dx["cache_policy"], c.index.dx.cache_policy);
+  }
+
+  // workloads (a top-level `client:` section is the default for every workload)
+  const ClientCfg client_default = LoadClient(y["client"], ClientCfg{});
   if (auto wls = y["workloads"]; wls && wls.IsSequence()) {
     c.workloads.clear();
     for (const auto& wl : wls) {
       WorkloadCfg cfg;
       cfg.name = wl["name"].as<std::string>("unnamed");
-      cfg.ops = wl["ops"].as<std::size_t>(1000);
+      cfg.trace = wl["trace"].as<std::string>("");
+      cfg.ops = wl["ops"].as<std::size_t>(cfg.trace.empty() ? 1000 : 0);
+      cfg.range_len = wl["range_len"].as<std::uint32_t>(1);
       if (auto mix = wl["mix"]) {
         cfg.mix.read = mix["read"].as<double>(1.0);
         cfg.mix.write = mix["write"].as<double>(0.0);
+        // without an explicit scan share, reads of a range workload are scans
+        if (mix["scan"]) cfg.mix.scan = mix["scan"].as<double>();
+        else if (cfg.range_len > 1) std::swap(cfg.mix.read, cfg.mix.scan);
       }
-      cfg.keyspace = wl["keyspace"].as<std::uint64_t>(100000);
+      cfg.keyspace = wl["keyspace"].as<std::uint64_t>(cfg.trace.empty() ? 100000 : 0);
       cfg.zipf = wl["zipf"].as<double>(0.99);
-      cfg.range_len = wl["range_len"].as<std::uint32_t>(1);
+      cfg.scramble_keys = wl["scramble_keys"].as<bool>(false);
+      cfg.zipf_sampler = (wl["zipf_sampler"].as<std::string>("rejection") == "cdf") ? ZipfSampler::Cdf : ZipfSampler::RejectionInversion;
+      cfg.client = LoadClient(wl["client"], client_default);
       c.workloads.push_back(cfg);
     }
   }
@@ -90,13 +191,73 @@ SimConf LoadConfig(const std::string& path){
   if (auto metrics = y["metrics"]; metrics) {
     c.metrics.out_dir = metrics["out_dir"].as<std::string>(c.metrics.out_dir);
     c.metrics.dump_per_op_trace = metrics["dump_per_op_trace"].as<bool>(c.metrics.dump_per_op_trace);
+    c.metrics.op_trace_sample_every = metrics["op_trace_sample_every"].as<std::uint64_t>(c.metrics.op_trace_sample_every);
+    c.metrics.op_trace_reservoir = metrics["op_trace_reservoir"].as<std::uint64_t>(c.metrics.op_trace_reservoir);
+    c.metrics.op_trace_compress = metrics["op_trace_compress"].as<bool>(c.metrics.op_trace_compress);
+    c.metrics.window_us = metrics["window_us"].as<double>(c.metrics.window_us);
     if (auto ptiles = metrics["ptiles"]; ptiles && ptiles.IsSequence()) {
       c.metrics.ptiles.clear();
       for (const auto& p : ptiles) {
-        c.metrics.ptiles.push_back(p.as<int>());
+        c.metrics.ptiles.push_back(p.as<double>());
       }
     }
   }
 
   return c;
-}
\ No newline at end of file
+}
+
+SimConf LoadConfig(const std::string& path){ return LoadConfigNode(YAML::LoadFile(path)); }
+
+// Set root[a][b]...[z] = v for a dotted key "a.b....z", creating maps as needed.
+static void set_dotted(YAML::Node root, const std::string& dotted, const YAML::Node& v){
+  YAML::Node n = root;
+  std::size_t b = 0, e;
+  while ((e = dotted.find('.', b)) != std::string::npos){
+    YAML::Node next = n[dotted.substr(b, e - b)];
+    n.reset(next);
+    b = e + 1;
+  }
+  n[dotted.substr(b)] = YAML::Clone(v);
+}
+
+static std::string scalar_text(const YAML::Node& v){
+  if (v.IsScalar()) return v.as<std::string>();
+  YAML::Emitter e; e << YAML::Flow << v; return e.c_str();
+}
+
+std::vector<Scenario> LoadSweep(const std::string& path){
+  auto spec = YAML::LoadFile(path);
+  fs::path base = spec["base"].as<std::string>();
+  if (base.is_relative()) base = fs::path(path).parent_path() / base;
+  const YAML::Node base_y = YAML::LoadFile(base.string());
+  const std::string stem = fs::path(path).stem().string();
+
+  // axes in spec order; cartesian product with the last axis varying fastest
+  std::vector<std::pair<std::string, YAML::Node>> axes;
+  if (auto sw = spec["sweep"]; sw && sw.IsMap())
+    for (const auto& kv : sw) axes.emplace_back(kv.first.as<std::string>(), kv.second);
+
+  std::vector<Scenario> out;
+  std::vector<std::size_t> pick(axes.size(), 0);
+  while (true){
+    YAML::Node y = YAML::Clone(base_y);
+    std::string name = stem;
+    for (std::size_t a = 0; a < axes.size(); ++a){
+      const YAML::Node& vals = axes[a].second;
+      YAML::Node v = vals.IsSequence() ? vals[pick[a]] : vals;
+      set_dotted(y, axes[a].first, v);
+      name += ":" + axes[a].first + "=" + scalar_text(v);
+    }
+    out.push_back(Scenario{name, LoadConfigNode(y)});
+    // odometer increment
+    std::size_t a = axes.size();
+    while (a > 0){
+      --a;
+      const std::size_t n = axes[a].second.IsSequence() ? axes[a].second.size() : 1;
+      if (++pick[a] < n) break;
+      pick[a] = 0;
+      if (a == 0) return out;
+    }
+    if (axes.empty()) return out;
+  }
+}
@@ -1,2 +1,164 @@
 #include "sim/event_loop.h"
-// header-only implementation; this TU exists to please some build systems.
+#include <algorithm>
+
+// ---- HeapQueue ----
+// Same comparator and push/pop sequence as std::priority_queue<Event>, but the
+// top is moved out instead of copied.
+static bool heap_after(SimTime a, SimTime b){ return a > b; }
+
+void HeapQueue::push(SimTime t, EventFn&& fn){
+  heap.push_back(Item{t, std::move(fn)});
+  std::push_heap(heap.begin(), heap.end(), [](const Item& a, const Item& b){ return heap_after(a.t, b.t); });
+}
+
+bool HeapQueue::pop(SimTime& t, EventFn& fn){
+  if (heap.empty()) return false;
+  std::pop_heap(heap.begin(), heap.end(), [](const Item& a, const Item& b){ return heap_after(a.t, b.t); });
+  t = heap.back().t; fn = std::move(heap.back().fn);
+  heap.pop_back();
+  return true;
+}
+
+// ---- CalendarQueue ----
+CalendarQueue::CalendarQueue() : head(kMinBuckets, kNil), tail(kMinBuckets, kNil) {}
+
+void CalendarQueue::clear(){
+  chunks.clear(); pool_size = 0; free_head = kNil;
+  head.assign(kMinBuckets, kNil); tail.assign(kMinBuckets, kNil);
+  width = 1.0; last_bucket = 0; cur_slot = 0; last_prio = 0.0; count = 0; next_seq = 0;
+}
+
+// Insert node i into its bucket keeping (t, seq) order. Appends are O(1), which
+// covers the common case of bursts scheduled at the same timestamp.
+void CalendarQueue::link(std::uint32_t i){
+  Node& n = node(i);
+  const std::size_t b = bucket_of(n.t);
+  n.next = kNil;
+  if (head[b] == kNil){ head[b] = tail[b] = i; return; }
+  if (!earlier(n, node(tail[b]))){ node(tail[b]).next = i; tail[b] = i; return; }
+  if (earlier(n, node(head[b]))){ n.next = head[b]; head[b] = i; return; }
+  std::uint32_t prev = head[b];
+  while (!earlier(n, node(node(prev).next))) prev = node(prev).next;
+  n.next = node(prev).next; node(prev).next = i;
+}
+
+void CalendarQueue::push(SimTime t, EventFn&& fn){
+  std::uint32_t i;
+  if (free_head != kNil){ i = free_head; free_head = node(i).next; }
+  else {
+    i = pool_size++;
+    if ((i >> kChunkBits) == chunks.size()) chunks.emplace_back(new Node[std::size_t(1) << kChunkBits]);
+  }
+  Node& n = node(i);
+  n.t = t; n.seq = next_seq++; n.fn = std::move(fn);
+  link(i);
+  ++count;
+  if (count == 1 || t < last_prio || slot_of(t) < cur_slot){
+    // Scheduled behind the scan position (or queue was idle): restart the year there.
+    last_prio = std::min(last_prio, t); if (count == 1) last_prio = t;
+    cur_slot = slot_of(t); last_bucket = bucket_of(t);
+  }
+  if (count > 2 * head.size()) resize(2 * head.size());
+}
+
+// Locate the earliest event and park the scan position on its bucket. Never
+// moves the scan past a pending event, so it is safe to call without popping.
+std::uint32_t CalendarQueue::find_min(){
+  const std::size_t nb = head.size();
+  std::size_t b = last_bucket;
+  std::uint64_t slot = cur_slot;
+  std::uint32_t hit = kNil;
+  for (std::size_t n = 0; n < nb; ++n){
+    const std::uint32_t h = head[b];
+    if (h != kNil && slot_of(node(h).t) <= slot){ hit = h; break; }
+    b = (b + 1 == nb) ? 0 : b + 1; ++slot;
+  }
+  if (hit == kNil){
+    // Sparse year: jump straight to the earliest bucket head.
+    for (std::size_t k = 0; k < nb; ++k){
+      const std::uint32_t h = head[k];
+      if (h != kNil && (hit == kNil || earlier(node(h), node(hit)))){ hit = h; b = k; }
+    }
+    slot = slot_of(node(hit).t);
+  }
+  last_bucket = b; cur_slot = slot;
+  return hit;
+}
+
+bool CalendarQueue::peek(SimTime& t){
+  if (count == 0) return false;
+  t = node(find_min()).t;
+  return true;
+}
+
+bool CalendarQueue::pop(SimTime& t, EventFn& fn){
+  if (count == 0) return false;
+  const std::size_t nb = head.size();
+  const std::uint32_t hit = find_min();
+  const std::size_t b = last_bucket;
+  Node& n = node(hit);
+  head[b] = n.next;
+  if (head[b] == kNil) tail[b] = kNil;
+  t = last_prio = n.t;
+  fn = std::move(n.fn);
+  n.next = free_head; free_head = hit;
+  --count;
+  if (nb > kMinBuckets && count < nb / 2) resize(nb / 2);
+  return true;
+}
+
+static constexpr double kMinWidth = 1e-6; // 1 ps; keeps t / width well inside uint64
+
+// Brown's heuristic: three times the mean separation of the earliest pending
+// events, ignoring outlier gaps. Keeps the current width when every sampled
+// event shares one timestamp.
+double CalendarQueue::estimate_width(){
+  scratch.clear();
+  for (std::uint32_t h : head)
+    for (std::uint32_t i = h; i != kNil; i = node(i).next) scratch.push_back(node(i).t);
+  const std::size_t k = std::min<std::size_t>(scratch.size(), 25);
+  if (k < 2) return width;
+  std::nth_element(scratch.begin(), scratch.begin() + (k - 1), scratch.end());
+  std::sort(scratch.begin(), scratch.begin() + k);
+  const double avg = (scratch[k - 1] - scratch[0]) / double(k - 1);
+  double sum = 0; int cnt = 0;
+  for (std::size_t i = 1; i < k; ++i){
+    const double d = scratch[i] - scratch[i - 1];
+    if (d <= 2.0 * avg){ sum += d; ++cnt; }
+  }
+  const double sep = cnt ? sum / cnt : avg;
+  return sep > 0 ? std::max(3.0 * sep, kMinWidth) : width;
+}
+
+void CalendarQueue::resize(std::size_t nb){
+  const double w = estimate_width();
+  std::vector<std::uint32_t> old;
+  old.swap(head);
+  head.assign(nb, kNil); tail.assign(nb, kNil);
+  width = w;
+  for (std::uint32_t h : old){
+    for (std::uint32_t i = h; i != kNil; ){
+      const std::uint32_t nx = node(i).next;
+      link(i); i = nx;
+    }
+  }
+  cur_slot = slot_of(last_prio); last_bucket = bucket_of(last_prio);
+}
+
+// ---- EventLoop ----
+void EventLoop::run(){
+  SimTime t; EventFn fn;
+  if (kind == EventQueueKind::Heap){
+    while (heap.pop(t, fn)){ now = t; if (now >= tick_at) on_tick(); fn(); ++executed; }
+  } else {
+    while (cal.pop(t, fn)){ now = t; if (now >= tick_at) on_tick(); fn(); ++executed; }
+  }
+}
+
+void EventLoop::run_until(SimTime horizon){
+  SimTime t; EventFn fn;
+  while (next_time(t) && t < horizon){
+    if (kind == EventQueueKind::Heap) heap.pop(t, fn); else cal.pop(t, fn);
+    now = t; if (now >= tick_at) on_tick(); fn(); ++executed;
+  }
+}
@@ -0,0 +1,58 @@
+#include "sim/fabric.h"
+#include <algorithm>
+#include <fstream>
+
+Port::Port(double link_gbps, double read_ops_per_s, double write_ops_per_s, double cas_ops_per_s)
+  : bytes_per_us(std::max(1e-9, link_gbps * 1e3 / 8.0)),
+    us_per_read(1e6 / std::max(1.0, read_ops_per_s)),
+    us_per_write(1e6 / std::max(1.0, write_ops_per_s)),
+    us_per_cas(1e6 / std::max(1.0, cas_ops_per_s)),
+    engine(0.1, 1.0), out(0.1, bytes_per_us), in(0.1, bytes_per_us) {}
+
+SimTime Port::op(SimTime t, Verb v, int shard){
+  const double cost = v == Verb::READ ? us_per_read : v == Verb::CAS ? us_per_cas : us_per_write;
+  ++ops;
+  return engine.reserve(t, cost, 0.0, shard);
+}
+
+SimTime Port::tx(SimTime t, std::size_t bytes, int shard){
+  if (!bytes) return t;
+  tx_bytes += bytes;
+  return out.reserve(t, double(bytes), double(bytes) / bytes_per_us, shard);
+}
+
+SimTime Port::rx(SimTime t, std::size_t bytes, int shard){
+  if (!bytes) return t;
+  rx_bytes += bytes;
+  return in.reserve(t, double(bytes), 0.0, shard); // cut-through behind the sender's serialization
+}
+
+Fabric::Fabric(const NicCaps& c, int compute_nodes, int memory_nodes){
+  for (int i=0; i<std::max(1, compute_nodes); ++i)
+    cs.push_back(std::make_unique<Port>(c.link_gbps, c.port_read_ops_per_s, c.port_write_ops_per_s, c.port_cas_ops_per_s));
+  for (int i=0; i<std::max(1, memory_nodes); ++i)
+    ms.push_back(std::make_unique<Port>(c.link_gbps, c.port_read_ops_per_s, c.port_write_ops_per_s, c.port_cas_ops_per_s));
+}
+
+static double util(const Port& p, SimTime span){
+  return span > 0 ? double(std::max(p.tx_bytes.load(), p.rx_bytes.load())) / (p.bytes_per_us * span) : 0.0;
+}
+
+double Fabric::max_util(SimTime span) const {
+  double u = 0;
+  for (const auto& p : cs) u = std::max(u, util(*p, span));
+  for (const auto& p : ms) u = std::max(u, util(*p, span));
+  return u;
+}
+
+void Fabric::write_util(const std::string& path, SimTime span) const {
+  std::ofstream out(path);
+  out << "node,id,ops,tx_bytes,rx_bytes,tx_util,rx_util\n";
+  auto row = [&](const char* kind, std::size_t id, const Port& p){
+    const double cap = p.bytes_per_us * span;
+    out << kind << ',' << id << ',' << p.ops << ',' << p.tx_bytes << ',' << p.rx_bytes << ','
+        << (cap > 0 ? double(p.tx_bytes) / cap : 0.0) << ',' << (cap > 0 ? double(p.rx_bytes) / cap : 0.0) << "\n";
+  };
+  for (std::size_t i=0; i<cs.size(); ++i) row("cs", i, *cs[i]);
+  for (std::size_t i=0; i<ms.size(); ++i) row("ms", i, *ms[i]);
+}
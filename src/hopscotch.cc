@@ -3,142 +3,131 @@
 
 namespace hopscotch {
 
-bool HopscotchOverlay::insert(std::uint64_t key, std::uint16_t leaf_slot) {
-  std::uint32_t home = hash_key(key) % num_slots_;
-  
-  // Check if key already exists (update case)
-  for (int i = 0; i < H_; ++i) {
-    int slot = (home + i) % num_slots_;
-    if (get_bitmap_bit(home, slot) && slots_[slot].valid && slots_[slot].key == key) {
-      slots_[slot].leaf_slot = leaf_slot; // update existing entry
-      return true;
-    }
-  }
-  
-  // Find empty slot within neighborhood
-  int empty_slot = find_empty_slot(home);
-  if (empty_slot == -1) {
-    // Try to displace entries to make space
-    for (int candidate = home; candidate < home + H_ && candidate < num_slots_; ++candidate) {
-      if (!slots_[candidate].valid && displace_closer(candidate, home)) {
-        empty_slot = candidate;
-        break;
-      }
-    }
-  }
-  
-  if (empty_slot == -1) {
-    return false; // table full, cannot insert
-  }
-  
-  // Insert the new entry
-  slots_[empty_slot] = Entry(key, leaf_slot);
-  set_bitmap_bit(home, empty_slot);
-  return true;
+HopscotchOverlay::HopscotchOverlay(int H, int slots)
+  : H_(std::clamp(H, 1, 64)), num_slots_(std::max(1, slots)), bitmap_(num_slots_, 0), slots_(num_slots_) {
+  H_ = std::min(H_, num_slots_);
+}
+
+int HopscotchOverlay::home_of(std::uint64_t key) const {
+  std::uint64_t x = key * 0x9e3779b97f4a7c15ull;
+  x ^= x >> 32;
+  return int(x % (std::uint64_t)num_slots_);
 }
 
 int HopscotchOverlay::lookup(std::uint64_t key) const {
-  std::uint32_t home = hash_key(key) % num_slots_;
-  
-  // Check neighborhood bitmap and probe slots
-  for (int i = 0; i < H_; ++i) {
-    int slot = (home + i) % num_slots_;
-    if (get_bitmap_bit(home, slot) && slots_[slot].valid && slots_[slot].key == key) {
-      return slots_[slot].leaf_slot;
-    }
+  const int home = home_of(key);
+  for (std::uint64_t b = bitmap_[home]; b; b &= b - 1){
+    const int slot = (home + __builtin_ctzll(b)) % num_slots_;
+    if (slots_[slot].key == key) return slot;
   }
-  
-  return -1; // not found
+  return -1;
 }
 
-void HopscotchOverlay::remove(std::uint64_t key) {
-  std::uint32_t home = hash_key(key) % num_slots_;
-  
-  for (int i = 0; i < H_; ++i) {
-    int slot = (home + i) % num_slots_;
-    if (get_bitmap_bit(home, slot) && slots_[slot].valid && slots_[slot].key == key) {
-      slots_[slot].valid = false;
-      clear_bitmap_bit(home, slot);
-      return;
+bool HopscotchOverlay::insert(std::uint64_t key, std::uint16_t leaf_slot){
+  if (const int pos = lookup(key); pos >= 0){ slots_[pos].leaf_slot = leaf_slot; return true; }
+  const int home = home_of(key);
+
+  // nearest free slot at or after home
+  int d = 0;
+  while (d < num_slots_ && slots_[(home + d) % num_slots_].valid) ++d;
+  if (d == num_slots_) return false;
+  int free = (home + d) % num_slots_;
+
+  // hop the free slot back toward home: move an entry whose neighborhood still
+  // covers it into it, freeing a slot nearer home
+  bool moved = false;
+  while (dist(home, free) >= H_){
+    bool hopped = false;
+    for (int back = H_ - 1; back > 0 && !hopped; --back){
+      const int cand = (free - back + num_slots_) % num_slots_;
+      if (!slots_[cand].valid) continue;
+      const int ch = home_of(slots_[cand].key);
+      if (dist(ch, free) >= H_ || dist(ch, cand) > dist(ch, free)) continue;
+      slots_[free] = slots_[cand];
+      bitmap_[ch] &= ~(1ull << dist(ch, cand));
+      bitmap_[ch] |= 1ull << dist(ch, free);
+      slots_[cand].valid = false;
+      free = cand; hopped = moved = true;
     }
+    if (!hopped) return false;
   }
+  if (moved) ++layout_;
+  slots_[free] = Entry{key, layout_, leaf_slot, true};
+  bitmap_[home] |= 1ull << dist(home, free);
+  ++count_;
+  return true;
 }
 
-void HopscotchOverlay::clear() {
-  std::fill(bitmap_.begin(), bitmap_.end(), 0);
-  for (auto& slot : slots_) {
-    slot.valid = false;
-  }
+void HopscotchOverlay::remove(std::uint64_t key){
+  const int pos = lookup(key);
+  if (pos < 0) return;
+  const int home = home_of(key);
+  bitmap_[home] &= ~(1ull << dist(home, pos));
+  slots_[pos].valid = false;
+  --count_;
 }
 
-double HopscotchOverlay::utilization() const {
-  int count = 0;
-  for (const auto& slot : slots_) {
-    if (slot.valid) count++;
-  }
-  return static_cast<double>(count) / num_slots_;
+void HopscotchOverlay::clear(){
+  std::fill(bitmap_.begin(), bitmap_.end(), 0);
+  for (auto& s : slots_) s.valid = false;
+  count_ = 0;
+  ++layout_;
 }
 
-int HopscotchOverlay::num_entries() const {
-  int count = 0;
-  for (const auto& slot : slots_) {
-    if (slot.valid) count++;
-  }
-  return count;
+OverlaySet::OverlaySet(const Conf& c) : conf(c) {
+  const std::size_t per = HopscotchOverlay(conf.H, conf.slots).bytes();
+  cap = conf.enable ? std::min<std::size_t>(std::max(0, conf.topK), conf.budget_bytes / per) : 0;
 }
 
-int HopscotchOverlay::find_empty_slot(int home) const {
-  for (int i = 0; i < H_; ++i) {
-    int slot = (home + i) % num_slots_;
-    if (!slots_[slot].valid) {
-      return slot;
-    }
-  }
-  return -1;
+HopscotchOverlay* OverlaySet::find(std::uint64_t leaf){
+  auto it = overlays.find(leaf);
+  return it == overlays.end() ? nullptr : &it->second;
 }
 
-bool HopscotchOverlay::displace_closer(int empty_slot, int home) {
-  // Try to move entries from further away to this empty slot
-  // to make space closer to home bucket
-  for (int candidate = std::max(0, empty_slot - H_ + 1); candidate < empty_slot; ++candidate) {
-    if (slots_[candidate].valid) {
-      std::uint32_t candidate_home = hash_key(slots_[candidate].key) % num_slots_;
-      
-      // Check if we can move this entry to empty_slot and still be in its neighborhood
-      int distance = (empty_slot - candidate_home + num_slots_) % num_slots_;
-      if (distance < H_) {
-        // Move the entry
-        clear_bitmap_bit(candidate_home, candidate);
-        set_bitmap_bit(candidate_home, empty_slot);
-        slots_[empty_slot] = slots_[candidate];
-        slots_[candidate].valid = false;
-        return true;
-      }
-    }
-  }
-  return false;
+std::size_t OverlaySet::bytes() const {
+  std::size_t b = 0;
+  for (const auto& [leaf, ov] : overlays) b += ov.bytes();
+  return b;
 }
 
-void HopscotchOverlay::set_bitmap_bit(int home, int slot) {
-  int bit_pos = (slot - home + num_slots_) % num_slots_;
-  if (bit_pos < 64) { // safety check for bitmap size
-    bitmap_[home] |= (1ULL << bit_pos);
+// Halve every count so the ranking follows the workload; drops cold leaves.
+void OverlaySet::age(){
+  for (auto it = heat.begin(); it != heat.end(); ){
+    if ((it->second >>= 1) == 0 && !overlays.count(it->first)) it = heat.erase(it);
+    else ++it;
   }
+  std::uint64_t leaf;
+  min_heat = overlays.empty() ? 0 : coldest(leaf);
 }
 
-void HopscotchOverlay::clear_bitmap_bit(int home, int slot) {
-  int bit_pos = (slot - home + num_slots_) % num_slots_;
-  if (bit_pos < 64) {
-    bitmap_[home] &= ~(1ULL << bit_pos);
+std::uint64_t OverlaySet::coldest(std::uint64_t& leaf) const {
+  std::uint64_t h = ~0ull;
+  for (const auto& [l, ov] : overlays){
+    const auto it = heat.find(l);
+    const std::uint64_t v = it == heat.end() ? 0 : it->second;
+    if (v < h){ h = v; leaf = l; }
   }
+  return h;
 }
 
-bool HopscotchOverlay::get_bitmap_bit(int home, int slot) const {
-  int bit_pos = (slot - home + num_slots_) % num_slots_;
-  if (bit_pos < 64) {
-    return (bitmap_[home] & (1ULL << bit_pos)) != 0;
+HopscotchOverlay* OverlaySet::touch(std::uint64_t leaf){
+  if (!cap) return nullptr;
+  if (++accesses % kAgeEvery == 0) age();
+  const std::uint64_t h = ++heat[leaf];
+  if (auto* ov = find(leaf)) return ov;
+
+  if (overlays.size() >= cap){
+    // overlaid counts only grow between agings, so min_heat stays a lower bound
+    if (h <= min_heat) return nullptr;
+    std::uint64_t cold = 0;
+    min_heat = coldest(cold);
+    if (h <= min_heat) return nullptr;
+    overlays.erase(cold);
   }
-  return false;
+  auto* ov = &overlays.emplace(leaf, HopscotchOverlay(conf.H, conf.slots)).first->second;
+  std::uint64_t l;
+  min_heat = coldest(l);
+  return ov;
 }
 
-} // namespace hopscotch
\ No newline at end of file
+} // namespace hopscotch
@@ -0,0 +1,276 @@
+#include "sim/index_dex.h"
+#include "sim/memory_server.h"
+#include <algorithm>
+#include <limits>
+#include <numeric>
+
+static constexpr std::size_t kMsgBytes = 64; // RPC request / small reply
+
+// ---- DexCluster ----
+DexCluster::DexCluster(const DexConf& c, int compute_nodes, int memory_nodes, int ms_cpu_cores,
+                       std::uint64_t ks, Pdes& p)
+  : conf(c), keyspace(std::max<std::uint64_t>(1, ks)), pdes(p),
+    cs(std::max(1, compute_nodes)) {
+  const int P = std::max(1, conf.num_partitions);
+  const int CS = (int)cs.size();
+  owner.resize(P);
+  for (int part=0; part<P; ++part) owner[part] = (int)((long long)part * CS / P); // contiguous ranges
+  heat.assign(P, 0); frozen_until.assign(P, 0.0); epochs.assign(P, 0);
+  ms_cpu.resize(std::max(1, memory_nodes));
+  for (auto& tb : ms_cpu) tb.init(conf.offload.ms_cpu_budget_ops_per_s, std::max(1, ms_cpu_cores), 0.0);
+  next_repartition = conf.repartition_period_ms > 0 ? conf.repartition_period_ms * 1e3
+                                                    : std::numeric_limits<SimTime>::infinity();
+}
+
+int DexCluster::partition_of(std::uint64_t key) const {
+  const int P = (int)owner.size();
+  return std::min(P - 1, (int)(double(key) / double(keyspace) * P));
+}
+
+int DexCluster::route(std::uint64_t key, SimTime now, SimTime& ready, int shard){
+  const int part = partition_of(key);
+  if (!shard_heat.empty()) shard_heat[shard][part]++;
+  else {
+    if (now >= next_repartition) repartition(now);
+    heat[part]++;
+  }
+  ready = std::max(now, frozen_until[part]);
+  return owner[part];
+}
+
+// Greedy rebalance of the topK hottest partitions of the last period: each
+// moves to the least loaded compute node if that lowers the pair's maximum.
+// A moved partition is unavailable for remap_broadcast_us and bumps its epoch
+// (caches holding its paths may be stale).
+void DexCluster::repartition(SimTime now){
+  std::vector<std::uint64_t> load(cs.size(), 0);
+  for (std::size_t part=0; part<owner.size(); ++part) load[owner[part]] += heat[part];
+  std::vector<int> order(owner.size());
+  std::iota(order.begin(), order.end(), 0);
+  const std::size_t k = std::min<std::size_t>(order.size(), std::max(0, conf.repartition_topK));
+  std::partial_sort(order.begin(), order.begin() + k, order.end(), [&](int a, int b){ return heat[a] > heat[b]; });
+  for (std::size_t i=0; i<k; ++i){
+    const int part = order[i];
+    if (heat[part] == 0) break;
+    const int src = owner[part];
+    const int dst = (int)(std::min_element(load.begin(), load.end()) - load.begin());
+    if (dst == src || load[dst] + heat[part] >= load[src]) continue;
+    owner[part] = dst;
+    load[src] -= heat[part]; load[dst] += heat[part];
+    frozen_until[part] = now + conf.remap_broadcast_us;
+    epochs[part]++;
+    remaps++;
+  }
+  std::fill(heat.begin(), heat.end(), 0);
+  while (next_repartition <= now) next_repartition += conf.repartition_period_ms * 1e3;
+}
+
+bool DexCluster::try_offload(int ms, SimTime now, int shard){
+  auto& tb = ms_cpu[ms % ms_cpu.size()];
+  if (!spent.empty()){
+    // committed balance refilled to now, less what this shard took since
+    double& own = spent[shard][ms % ms_cpu.size()];
+    const double avail = std::min(tb.burst, tb.tokens + std::max(0.0, now - tb.last_refill) * tb.rate_ops_per_us);
+    if (avail - own < 1.0) return false;
+    own += 1.0;
+    offloaded++;
+    return true;
+  }
+  if (now > tb.last_refill){
+    tb.tokens = std::min(tb.burst, tb.tokens + (now - tb.last_refill) * tb.rate_ops_per_us);
+    tb.last_refill = now;
+  }
+  if (tb.tokens < 1.0) return false;
+  tb.tokens -= 1.0;
+  offloaded++;
+  return true;
+}
+
+void DexCluster::shards(int n){
+  shard_heat.assign(n > 1 ? n : 0, std::vector<std::uint64_t>(owner.size(), 0));
+  spent.assign(shard_heat.size(), std::vector<double>(ms_cpu.size(), 0.0));
+}
+
+// Shards may together overdraw a budget within one window; the debt is
+// carried and repaid by the refill.
+void DexCluster::commit(SimTime t_end){
+  for (auto& h : shard_heat)
+    for (std::size_t part=0; part<h.size(); ++part){ heat[part] += h[part]; h[part] = 0; }
+  if (t_end >= next_repartition) repartition(next_repartition);
+  for (std::size_t ms=0; ms<ms_cpu.size(); ++ms){
+    auto& tb = ms_cpu[ms];
+    if (t_end > tb.last_refill){
+      tb.tokens = std::min(tb.burst, tb.tokens + (t_end - tb.last_refill) * tb.rate_ops_per_us);
+      tb.last_refill = t_end;
+    }
+    for (auto& sp : spent){ tb.tokens -= sp[ms]; sp[ms] = 0.0; }
+  }
+}
+
+// ---- Dex ----
+Dex::Dex(const IndexCtx& c, DexConf dc, NodeCache& nc, DexCluster& cluster)
+  : conf(dc), cache(nc), cl(cluster),
+    rng(0x2545f4914f6cdd1dull * std::uint64_t(c.cs_id * 1024 + c.qp + 1)) {
+  ctx = c;
+}
+
+void Dex::get(std::uint64_t key, Metrics& m, std::uint64_t op_id){ dispatch(OpType::Get, key, 1, m, op_id); }
+void Dex::put(std::uint64_t key, Metrics& m, std::uint64_t op_id){ dispatch(OpType::Put, key, 1, m, op_id); }
+void Dex::scan(std::uint64_t start_key, std::uint32_t len, Metrics& m, std::uint64_t op_id){ dispatch(OpType::Scan, start_key, len, m, op_id); }
+
+// Serve locally when this compute node owns the key's partition; otherwise
+// SEND the op to a server thread of the owner (possibly on another PDES
+// shard), which executes it against its own NIC and SENDs the reply back.
+void Dex::dispatch(OpType op, std::uint64_t key, std::uint32_t len, Metrics& m, std::uint64_t op_id){
+  const SimTime start = ctx.loop->now;
+  SimTime ready = start;
+  const int owner = conf.logical_partitioning ? cl.route(key, start, ready, ctx.nic->shard) : ctx.cs_id;
+  if (owner == ctx.cs_id){
+    auto run = [this, op, key, len, &m, op_id, start]{
+      Cost cost; SimTime done = execute(op, key, len, m, cost);
+      cost.path = ctx.nic->path(ctx.cs_id, ctx.qp, ctx.loop->now);
+      finish(op, start, done, cost, m, op_id);
+    };
+    if (ready > start) ctx.loop->at(ready, run); else run();
+    return;
+  }
+
+  cl.forwarded++;
+  Cost cost;
+  const SimTime sent = post(RdmaReq{Verb::SEND, Target::DRAM, kMsgBytes, ctx.qp, ctx.cs_id, ctx.ms_id, owner}, m, cost);
+  cost.path = ctx.nic->path(ctx.cs_id, ctx.qp, start);
+  const auto& dst = cl.cs[owner];
+  Dex* server = dst.servers[op_id % dst.servers.size()];
+  const int src_shard = cl.cs[ctx.cs_id].shard, dst_shard = dst.shard;
+  cl.pdes.send(src_shard, dst_shard, std::max(sent, ready), [=, this, &m]{
+    Metrics& sm = *cl.cs[server->ctx.cs_id].metrics;
+    Cost remote; remote.recvs++; sm.recv_ops++;
+    const SimTime done = server->execute(op, key, len, sm, remote);
+    remote.path = server->ctx.nic->path(server->ctx.cs_id, server->ctx.qp, server->ctx.loop->now);
+    server->ctx.loop->at(done, [=, this, &m, &sm]() mutable {
+      const std::size_t reply = op == OpType::Scan ? std::size_t(len) * ctx.leaf_entry_bytes : kMsgBytes;
+      const SimTime back = server->post(RdmaReq{Verb::SEND, Target::DRAM, reply, server->ctx.qp, server->ctx.cs_id, server->ctx.ms_id, ctx.cs_id}, sm, remote);
+      Cost total = cost;
+      total.reads += remote.reads; total.writes += remote.writes; total.cas += remote.cas;
+      total.sends += remote.sends; total.recvs += remote.recvs + 1; total.br += remote.br; total.bw += remote.bw;
+      // request, execution on the owner, reply; the hops between shards are "other"
+      total.path += remote.path;
+      total.path += server->ctx.nic->path(server->ctx.cs_id, server->ctx.qp, server->ctx.loop->now);
+      cl.pdes.send(dst_shard, src_shard, back, [=, this, &m]{
+        m.recv_ops++;
+        finish(op, start, ctx.loop->now, total, m, op_id);
+      });
+    });
+  });
+}
+
+SimTime Dex::post(const RdmaReq& r, Metrics& m, Cost& cost){
+  auto c = ctx.nic->post(r);
+  switch (r.verb){
+    case Verb::READ:  m.remote_reads++;  m.bytes_read += r.bytes;  cost.reads++;  cost.br += r.bytes; break;
+    case Verb::WRITE: m.remote_writes++; m.bytes_write += r.bytes; cost.writes++; cost.bw += r.bytes; break;
+    case Verb::CAS:   m.remote_cas++;  cost.cas++;  break;
+    case Verb::SEND:  m.send_ops++;    cost.sends++; break;
+    case Verb::RECV:  m.recv_ops++;    cost.recvs++; break;
+  }
+  return c.when;
+}
+
+// Path-aware cache: internal nodes are admitted only below a cached parent, so
+// the cache holds a connected top of the tree. After a remap of the key's
+// partition, cached paths are stale with probability cache_inval_prob and get
+// refetched. A miss is offloaded (the MS walks the remaining levels in its DRAM
+// and returns the entry) when allowed and the MS CPU budget has room.
+bool Dex::traverse(const std::vector<std::uint64_t>& nodes, std::uint64_t key, bool may_offload,
+                   Metrics& m, Cost& cost, SimTime& done){
+  bool stale = false;
+  if (conf.logical_partitioning && conf.cache_inval_prob > 0){
+    const int part = cl.partition_of(key);
+    if (seen_epoch.size() <= (std::size_t)part) seen_epoch.resize(part + 1, 0);
+    const std::uint32_t e = cl.epoch(part);
+    if (e != seen_epoch[part]){ seen_epoch[part] = e; stale = U(rng) < conf.cache_inval_prob; }
+  }
+  bool parent_cached = true, retried = false;
+  for (int lvl=0; lvl+1<(int)nodes.size(); ++lvl){
+    const CacheKey k{nodes[lvl], lvl};
+    const std::uint32_t ver = ctx.tree->version(nodes[lvl]);
+    std::uint32_t seen = 0;
+    if (conf.path_aware_cache && !stale && cache.get(k, &seen)){
+      if (seen == ver) continue;
+      // changed by a split since it was cached: fences reject the key below, re-read it
+      m.stale_hits++;
+      if (!retried){ m.stale_retries++; retried = true; }
+    }
+    if (may_offload && cl.try_offload(ctx.ms_id, ctx.loop->now, ctx.nic->shard)){
+      // the MS CPU walks the remaining levels in local DRAM between request and reply
+      const SimTime c = post(RdmaReq{Verb::SEND, Target::DRAM, kMsgBytes, ctx.qp, ctx.cs_id, ctx.ms_id}, m, cost);
+      m.recv_ops++; cost.recvs++;
+      MemoryServer& ms = ctx.nic->mem->at(ctx.ms_id);
+      const SimTime half = ctx.nic->caps.base_rtt_us / 2;
+      done = std::max(done, ms.cpu(c - half, double(nodes.size() - lvl) * ms.dram_lat_us(), ctx.nic->shard) + half);
+      return false;
+    }
+    done = std::max(done, post(RdmaReq{Verb::READ, Target::DRAM, ctx.node_bytes, ctx.qp, ctx.cs_id, ctx.ms_id}, m, cost));
+    parent_cached = conf.path_aware_cache && parent_cached;
+    if (parent_cached) cache.put(k, ctx.node_bytes, ver);
+  }
+  return true;
+}
+
+SimTime Dex::execute(OpType op, std::uint64_t key, std::uint32_t len, Metrics& m, Cost& cost){
+  SimTime done = ctx.loop->now;
+  std::vector<std::uint64_t> nodes;
+  const auto leaf = ctx.tree->path(key, nodes);
+
+  if (op == OpType::Get){
+    if (traverse(nodes, key, conf.offload.enable, m, cost, done))
+      done = std::max(done, post(RdmaReq{Verb::READ, Target::DRAM, ctx.node_bytes, ctx.qp, ctx.cs_id, ctx.ms_id}, m, cost));
+    return done;
+  }
+
+  traverse(nodes, key, false, m, cost, done);
+  if (op == OpType::Scan){
+    std::vector<std::uint64_t> leaves; ctx.tree->leaves_in_range(key, len, leaves);
+    std::vector<RdmaReq> chain(leaves.size(), RdmaReq{Verb::READ, Target::DRAM, ctx.node_bytes, ctx.qp, ctx.cs_id, ctx.ms_id});
+    done = std::max(done, ctx.nic->post_chain(chain).when);
+    m.remote_reads += chain.size(); m.bytes_read += chain.size() * ctx.node_bytes;
+    cost.reads += chain.size(); cost.br += chain.size() * ctx.node_bytes;
+    return done;
+  }
+
+  // Put. The owner is the only writer of its partition, so no remote lock;
+  // without partitioning every writer takes the leaf lock in DRAM.
+  const bool lock = !conf.logical_partitioning;
+  if (lock) done = std::max(done, post(RdmaReq{Verb::CAS, Target::DRAM, 8, ctx.qp, ctx.cs_id, ctx.ms_id}, m, cost));
+  done = std::max(done, post(RdmaReq{Verb::WRITE, Target::DRAM, ctx.leaf_entry_bytes, ctx.qp, ctx.cs_id, ctx.ms_id}, m, cost));
+  // with several shards the split is known after the window barrier and its
+  // writes go out from there, off this op's path
+  const auto split = ctx.tree->insert(leaf, 1.0, ctx.nic->shard, ctx.loop->now,
+                                      [this, &m](const BTreeModel::Split& s){ Cost c; write_split(s, m, c); });
+  done = std::max(done, write_split(split, m, cost));
+  if (lock) done = std::max(done, post(RdmaReq{Verb::WRITE, Target::DRAM, 8, ctx.qp, ctx.cs_id, ctx.ms_id}, m, cost));
+  return done;
+}
+
+// New nodes of a split: sibling + parent separator per split level, plus the
+// new root. Returns their completion (now if nothing split).
+SimTime Dex::write_split(const BTreeModel::Split& split, Metrics& m, Cost& cost){
+  SimTime done = ctx.loop->now;
+  if (split.sibling == BTreeModel::kNone) return done;
+  for (int i=0; i<1 + split.internal_splits + (split.new_root ? 1 : 0); ++i)
+    done = std::max(done, post(RdmaReq{Verb::WRITE, Target::DRAM, ctx.node_bytes, ctx.qp, ctx.cs_id, ctx.ms_id}, m, cost));
+  for (int i=0; i<1 + split.internal_splits; ++i)
+    done = std::max(done, post(RdmaReq{Verb::WRITE, Target::DRAM, 64, ctx.qp, ctx.cs_id, ctx.ms_id}, m, cost));
+  return done;
+}
+
+void Dex::finish(OpType op, SimTime start, SimTime done, const Cost& cost, Metrics& m, std::uint64_t op_id){
+  ctx.loop->at(done, [this, op, start, done, cost, &m, op_id]{
+    m.ops++; const double lat = done - start; m.add_latency(lat, done);
+    m.add_breakdown(op, lat, cost.path);
+    if (op == OpType::Scan){ m.scans++; m.scan_lat_us.add(lat); m.scan_bytes_r += cost.br; }
+    m.dump_op(op_id, op, lat,
+              cost.reads, cost.writes, cost.cas, cost.sends, cost.recvs, cost.br, cost.bw);
+    m.on_done(done); if (ctx.sink) ctx.sink->op_done(op_id, done);
+  });
+}
@@ -1,340 +1,381 @@
 #include "sim/index_sherman.h"
 #include "sim/config.h"
+#include "sim/memory_server.h"
 #include <algorithm>
 #include <cstdlib>
 
-Sherman::Sherman(const IndexCtx& c, ShermanConf sc, std::size_t cache_bytes)
-  : conf(sc), glt(sc.hocl.glt_slots), cache(cache_bytes) { 
-  ctx=c; 
-  
-  // Configure RDWC delegation table
-  delegation_table.config.enable = sc.rdwc.enable;
-  delegation_table.config.window_ns = std::chrono::microseconds(static_cast<long>(sc.rdwc.window_us));
-  delegation_table.config.collision_policy = 
-    (sc.rdwc.collision_policy == ShermanConf::rdwc_t::CollisionPolicy::BYPASS) ? 
-    rdwc::DelegationTable::Config::BYPASS : rdwc::DelegationTable::Config::QUEUE;
+Sherman::Sherman(const IndexCtx& c, ShermanConf sc, NodeCache& nc, LockTables& lt, rdwc::DelegationTable& dt,
+                 hopscotch::OverlaySet& hs)
+  : conf(sc), locks(lt), llt(*lt.llt[c.cs_id]), cache(nc), rdwc(dt), hop(hs) {
+  ctx=c;
 }
 
 std::uint64_t Sherman::path_to_leaf(std::uint64_t key, std::vector<std::uint64_t>& nodes){
-  std::uint64_t n1 = key >> 32, n2 = key >> 16, leaf = key;
-  nodes = {n1, n2, leaf}; return leaf;
+  return ctx.tree->path(key, nodes);
 }
 
-void Sherman::read_node(std::uint64_t node_id, int level, Metrics& m, SimTime& completion){
-  bool hit = cache.get({node_id, level});
-  if (hit) return;
+// Cached nodes carry the tree version they were read at. A hit on a node that
+// has changed since (split, new separator) sends the traversal astray: the
+// fence keys of the next node reject the key, so the node is re-read.
+bool Sherman::read_node(std::uint64_t node_id, int level, Metrics& m, SimTime& completion){
+  const std::uint32_t ver = ctx.tree->version(node_id);
+  std::uint32_t seen = 0;
+  const bool hit = cache.get({node_id, level}, &seen);
+  if (hit && seen == ver) return false;
+  if (hit) m.stale_hits++;
   RdmaReq r{Verb::READ, Target::DRAM, ctx.node_bytes, ctx.qp, ctx.cs_id, ctx.ms_id};
   auto c = ctx.nic->post(r);
   completion = std::max(completion, c.when);
   m.remote_reads++; m.bytes_read += ctx.node_bytes;
-  cache.put({node_id, level}, ctx.node_bytes);
+  cache.put({node_id, level}, ctx.node_bytes, ver);
+  return hit;
 }
 
-int Sherman::leaf_capacity() const { return conf.leaf_max_entries>0 ? conf.leaf_max_entries : (int)(ctx.node_bytes / ctx.leaf_entry_bytes); }
+// First `depth` nodes of a root-to-leaf path; one retry per traversal that met a stale node.
+void Sherman::read_path(const std::vector<std::uint64_t>& nodes, int depth, Metrics& m, SimTime& completion){
+  bool stale = false;
+  for (int lvl=0; lvl<depth; ++lvl) stale |= read_node(nodes[lvl], lvl, m, completion);
+  if (stale) m.stale_retries++;
+}
+
+int Sherman::leaf_capacity() const { return ctx.tree->leaf_capacity(); }
 
 std::uint64_t Sherman::glt_slot(std::uint64_t leaf) const {
-  if (!conf.model_glt_collisions) return leaf % glt.slots;
+  const std::uint64_t slots = std::max(1, conf.hocl.glt_slots);
+  if (!conf.model_glt_collisions) return leaf % slots;
   std::uint64_t x = leaf ^ (std::uint64_t)conf.hocl.glt_slots ^ (std::uint64_t)conf.glt_hash_seed;
   x ^= (x >> 33); x *= 0xff51afd7ed558ccdull; x ^= (x >> 33); x *= 0xc4ceb9fe1a85ec53ull; x ^= (x >> 33);
-  return x % glt.slots;
+  return x % slots;
+}
+
+// GLT words beyond the RNIC's on-chip capacity spill to MS DRAM (and cost DRAM verbs).
+Target Sherman::lock_target(std::uint64_t leaf) const {
+  if (!conf.hocl.enable) return Target::DRAM;
+  if (ctx.nic->mem && glt_slot(leaf) >= ctx.nic->mem->onchip_lock_slots()) return Target::DRAM;
+  return Target::RNIC_ONCHIP;
 }
 
-// Always acquire a real lock.
-// - HOCL enabled: LLT (local fairness queue) -> GLT (on-chip CAS spin)
-// - HOCL disabled: DRAM CAS spin (no LLT), higher RTT via NIC model
-void Sherman::hocl_acquire(std::uint64_t leaf, int tid, Metrics& m, SimTime& completion){
+// Lock acquisition as a chain of CAS events, each observing the lock state at
+// its completion time:
+// - HOCL enabled: LLT (local fairness queue) -> GLT (on-chip CAS)
+// - HOCL disabled: DRAM CAS (no LLT), higher RTT via NIC model
+// A failed CAS backs off cas_backoff_us and retries until the holder releases.
+void Sherman::hocl_acquire(std::shared_ptr<PutOp> op, Metrics& m){
   const bool hocl = conf.hocl.enable;
-  const auto slot = glt_slot(leaf);
+  op->lock_start = ctx.loop->now;
 
-  // LLT: enqueue and model local queueing delay (no NIC), to hand over fairly.
+  if (hocl && lock_target(op->leaf) == Target::DRAM) m.lock_spills++;
+
+  // LLT: queue behind this node's other writers of the leaf; only the head
+  // goes for the global lock, the rest wait locally (no NIC) to be woken.
   if (hocl && conf.hocl.llt_enable){
-    int pos = llt.enqueue_and_pos(leaf, tid);
-    if (pos > 0){
-      // completion += conf.hocl.hocl.llt_local_wait_us; // per-position unit delay (can be tuned)
-      completion += conf.hocl.llt_local_wait_us * pos;
-    }
+    auto wake = [this, op, &m](bool handed_over){
+      op->path.us[LatBreakdown::Lock] += ctx.loop->now - op->lock_start;
+      if (!handed_over){ cas_attempt(op, m); return; }
+      // the predecessor passed the global lock along: no CAS at all
+      m.lock_wait_us.add(ctx.loop->now - op->lock_start);
+      m.cas_per_write[0]++;
+      write_locked(op, m);
+    };
+    if (llt.enqueue(op->leaf, op->holder, std::move(wake)) > 0) return;
   }
+  cas_attempt(op, m);
+}
 
-  // GLT/DRAM lock via CAS spin, NIC-timed
-  Target cas_target = hocl ? Target::RNIC_ONCHIP : Target::DRAM;
-
-  int retries = 0;
-  while (true){
-    RdmaReq cas{Verb::CAS, cas_target, 8, ctx.qp, ctx.cs_id, ctx.ms_id};
-    auto c = ctx.nic->post(cas);
-    completion = std::max(completion, c.when);
-    m.remote_cas++;
-
-    // If lock is free and we're allowed (head when LLT enabled), take it.
-    const bool at_head = (!hocl || !conf.hocl.llt_enable) ? true : llt.at_head(leaf, tid);
-    if (at_head && glt.owner[slot] == -1){
-      glt.owner[slot] = tid;
-      break;
-    }
-    // Else backoff and retry
-    retries++;
-    completion += conf.cas_backoff_us;
-    if (retries >= conf.cas_max_retries){
-      // Break after extended retries to avoid infinite loop in simulation
-      // Force acquire the lock to ensure progress
-      glt.owner[slot] = tid;
-      break;
-    }
-  }
+void Sherman::cas_attempt(std::shared_ptr<PutOp> op, Metrics& m){
+  RdmaReq cas{Verb::CAS, lock_target(op->leaf), 8, ctx.qp, ctx.cs_id, locks.home(op->leaf)};
+  auto c = ctx.nic->post(cas);
+  m.remote_cas++; op->cost.cas++; op->cas++;
+  // The lock word's shard tries the CAS as it arrives and sends back the
+  // outcome for its completion. Only the LLT head gets here with HOCL.
+  const int home = locks.home(op->leaf), me = ctx.nic->shard;
+  locks.pdes.send(me, locks.glt_shard(home), c.when - locks.lead_us, [this, op, &m, c, home, me]{
+    const bool got = locks.glt[home]->try_lock(glt_slot(op->leaf), op->holder);
+    locks.pdes.send(locks.glt_shard(home), me, c.when, [this, op, &m, cas_path = c.path, got]{
+      if (got){
+        m.lock_wait_us.add(ctx.loop->now - op->lock_start);
+        m.cas_per_write[std::min<std::size_t>(op->cas, Metrics::kMaxCasPerWrite)]++;
+        op->path += cas_path;
+        write_locked(op, m);
+        return;
+      }
+      m.lock_retries++;
+      op->path.us[LatBreakdown::Lock] += cas_path.total();
+      op->path.us[LatBreakdown::Backoff] += conf.cas_backoff_us;
+      ctx.loop->after(conf.cas_backoff_us, [this, op, &m]{ cas_attempt(op, m); });
+    });
+  });
 }
 
-// Schedule-only release (used when unlock RDMA is already part of a chain)
-void Sherman::hocl_release_state_at(std::uint64_t leaf, int tid, SimTime when){
-  auto slot = glt_slot(leaf);
-  ctx.loop->at(when, [this, leaf, tid, slot]{
-    // Free GLT owner
-    if (slot < (std::size_t)glt.owner.size() && glt.owner[slot] == tid){
-      glt.owner[slot] = -1;
-    } else {
-      // If owner mismatch, clear anyway to avoid permanent wedging in a sim
-      if (slot < (std::size_t)glt.owner.size()) glt.owner[slot] = -1;
+// Schedule-only release (used when unlock RDMA is already part of a chain, or
+// skipped for a hand-over) of a lock verb completing at `when`. The GLT word is
+// freed, or passed to the next local waiter, when the verb reaches it; that
+// waiter either inherits the global lock (handover) or starts its own CAS.
+void Sherman::hocl_release_state_at(std::uint64_t leaf, std::int64_t holder, SimTime when, bool handover, Metrics& m){
+  const int home = locks.home(leaf);
+  const std::int64_t next = handover ? llt.successor(leaf) : -1;
+  locks.pdes.send(ctx.nic->shard, locks.glt_shard(home), when - locks.lead_us, [this, leaf, holder, next, home]{
+    GLT& glt = *locks.glt[home];
+    if (next >= 0) glt.pass(glt_slot(leaf), holder, next); else glt.unlock(glt_slot(leaf), holder);
+  });
+  if (!conf.hocl.enable || !conf.hocl.llt_enable) return;
+  ctx.loop->at(when, [this, leaf, holder, handover, &m]{
+    LLT::Waiter next = llt.release(leaf, holder, handover);
+    if (handover && next.wake){
+      m.lock_handovers++;
+      m.handover_saved_verbs += 2; // our unlock WRITE and the successor's CAS
     }
-    // Release LLT head
-    if (conf.hocl.enable && conf.hocl.llt_enable) llt.release(leaf, tid);
+    if (next.wake) ctx.loop->after(conf.hocl.llt_local_wait_us, [w = std::move(next.wake), handover]{ w(handover); });
   });
 }
 
 // Post unlock (writes lock word) and schedule state release when NIC completes.
-void Sherman::hocl_release(std::uint64_t leaf, int tid, Metrics& m, SimTime& completion){
-  Target unlock_target = conf.hocl.enable ? Target::RNIC_ONCHIP : Target::DRAM;
-  RdmaReq w{Verb::WRITE, unlock_target, 8, ctx.qp, ctx.cs_id, ctx.ms_id};
+void Sherman::hocl_release(std::uint64_t leaf, std::int64_t holder, Metrics& m, SimTime& completion){
+  Target unlock_target = lock_target(leaf);
+  RdmaReq w{Verb::WRITE, unlock_target, 8, ctx.qp, ctx.cs_id, locks.home(leaf)};
   auto c = ctx.nic->post(w);
   completion = std::max(completion, c.when);
   m.remote_writes++; m.bytes_write += 8;
 
-  hocl_release_state_at(leaf, tid, c.when);
+  hocl_release_state_at(leaf, holder, c.when, false, m);
 }
 
-void Sherman::get(std::uint64_t key, Metrics& m, std::uint64_t op_id){
-  if (conf.rdwc.enable) {
-    // Try RDWC delegation
-    auto [is_delegate, entry] = delegation_table.try_delegate_get(key, op_id, 
-      [&](bool success, const std::string& result) {
-        // Waiter callback - operation completed by delegate
-        if (success) {
-          m.ops++;
-          // For simulation, we don't track the actual result content
-          // The delegate already updated the metrics for RDMA operations
-        }
-      });
-    
-    if (!is_delegate) {
-      // This thread is a waiter, delegate will handle the operation
-      return;
-    }
-    
-    // This thread is the delegate, execute the operation
-    delegate_get_impl(key, m, op_id);
-    
-    // Notify waiters
-    std::uint64_t key_hash = std::hash<std::uint64_t>{}(key);
-    delegation_table.complete_delegation(key_hash, true, "success");
+void Sherman::get(std::uint64_t key, Metrics& m, std::uint64_t op_id){ get_at(key, m, op_id, ctx.loop->now); }
+void Sherman::put(std::uint64_t key, Metrics& m, std::uint64_t op_id){ put_at(key, m, op_id, ctx.loop->now); }
+
+// RDWC read: join an in-flight read of the same key from this compute node and
+// complete with it, no verbs of our own.
+void Sherman::get_at(std::uint64_t key, Metrics& m, std::uint64_t op_id, SimTime start){
+  using J = rdwc::DelegationTable::Join;
+  SimTime done = 0;
+  switch (rdwc.read(key, ctx.loop->now, done)){
+  case J::Combined:
+    m.rdwc_reads++;
+    ctx.loop->at(done, [this, &m, w = rdwc::DelegationTable::Waiter{key, op_id, start, this}, done]{ finish_combined(OpType::Get, m, w, done); });
+    return;
+  case J::Queued:
+    ctx.loop->at(done, [this, key, &m, op_id, start]{ get_at(key, m, op_id, start); });
+    return;
+  case J::Delegate:
+    rdwc.read_done(key, delegate_get_impl(key, m, op_id, start));
+    return;
+  case J::Bypass:
+    delegate_get_impl(key, m, op_id, start);
     return;
   }
-  
-  // Original GET implementation (non-delegated)
-  delegate_get_impl(key, m, op_id);
 }
 
-void Sherman::delegate_get_impl(std::uint64_t key, Metrics& m, std::uint64_t op_id){
-  SimTime start = ctx.loop->now, done = start; std::uint64_t br0=m.bytes_read, bw0=m.bytes_write; auto rr0=m.remote_reads.load(), rw0=m.remote_writes.load(), rc0=m.remote_cas.load();
-  std::vector<std::uint64_t> nodes; auto leaf = path_to_leaf(key, nodes);
-  for (int lvl=0; lvl<(int)nodes.size(); ++lvl) read_node(nodes[lvl], lvl, m, done);
-  
-  // Track leaf access for hopscotch overlay management
-  hopscotch_track_leaf_access(leaf);
-  hopscotch_maybe_create_overlay(leaf, m);
-  
-  // Try hopscotch overlay probe first (if enabled and overlay exists)
-  int hopscotch_slot = hopscotch_probe_overlay(leaf, key, m);
-  std::uint64_t entry_bytes_to_read = ctx.leaf_entry_bytes;
-  
-  if (hopscotch_slot >= 0) {
-    // Overlay hit! We know the exact slot, so we can read just that entry
-    // This reduces bytes read compared to full leaf scan
-    // TODO: For now, still read full entry for compatibility
-    // Future optimization: could read just the specific slot offset
-  } else {
-    // Overlay miss or no overlay - need to read entry for scanning
-    // This is the traditional path
+// RDWC write: park behind the delegate writing the same key; its write-back
+// carries ours (write_locked completes the combined ops).
+void Sherman::put_at(std::uint64_t key, Metrics& m, std::uint64_t op_id, SimTime start){
+  using J = rdwc::DelegationTable::Join;
+  switch (rdwc.write(key, ctx.loop->now, start, op_id, this)){
+  case J::Combined: m.rdwc_writes++; return;
+  case J::Queued: return; // retried when the slot's holder closes it
+  case J::Delegate: case J::Bypass: delegate_put_impl(key, m, op_id, start); return;
   }
-  
-  RdmaReq r{Verb::READ, Target::DRAM, entry_bytes_to_read, ctx.qp, ctx.cs_id, ctx.ms_id};
-  auto c = ctx.nic->post(r); done = std::max(done, c.when); m.remote_reads++; m.bytes_read += entry_bytes_to_read;
+}
 
-  // Version validation (node-level then entry-level)
-  auto& meta = leafs[leaf]; if (meta.entry_ver.empty()) meta.entry_ver.resize(leaf_capacity(), 0);
-  std::uint64_t node_ver_before = meta.node_ver;
-  bool retry=false;
-  if (conf.enable_two_level_versions){
-    if (meta.node_ver != node_ver_before) retry=true;
-    int idx = (int)(key % leaf_capacity());
-    std::uint64_t ev_before = meta.entry_ver[idx];
-    (void)ev_before;
-    if (meta.entry_ver[idx] != ev_before) retry=true;
-  }
-  if (retry){
-    RdmaReq r2{Verb::READ, Target::DRAM, ctx.node_bytes, ctx.qp, ctx.cs_id, ctx.ms_id};
-    auto c2 = ctx.nic->post(r2); done = std::max(done, c2.when); m.remote_reads++; m.bytes_read += ctx.node_bytes;
+void Sherman::finish_combined(OpType kind, Metrics& m, const rdwc::DelegationTable::Waiter& w, SimTime done){
+  m.ops++; double lat = done - w.start; m.add_latency(lat, done);
+  m.add_breakdown(kind, lat, {});
+  m.dump_op(w.op_id, kind, lat, 0, 0, 0, 0, 0, 0, 0);
+  m.on_done(done); if (w.issuer->ctx.sink) w.issuer->ctx.sink->op_done(w.op_id, done);
+}
+
+SimTime Sherman::delegate_get_impl(std::uint64_t key, Metrics& m, std::uint64_t op_id, SimTime start){
+  SimTime done = ctx.loop->now; std::uint64_t br0=m.bytes_read, bw0=m.bytes_write; auto rr0=m.remote_reads.load(), rw0=m.remote_writes.load(), rc0=m.remote_cas.load();
+  std::vector<std::uint64_t> nodes; auto leaf = path_to_leaf(key, nodes);
+  // A hot leaf that would be fetched whole is read by slot or neighborhood instead
+  hopscotch::HopscotchOverlay* ov = hopscotch_leaf(leaf, (int)nodes.size() - 1, key);
+  read_path(nodes, (int)nodes.size() - (ov ? 1 : 0), m, done);
+
+  if (ov) hopscotch_read(*ov, key, m, done);
+  else {
+    RdmaReq r{Verb::READ, Target::DRAM, ctx.leaf_entry_bytes, ctx.qp, ctx.cs_id, ctx.ms_id};
+    auto c = ctx.nic->post(r); done = std::max(done, c.when); m.remote_reads++; m.bytes_read += ctx.leaf_entry_bytes;
+    // the whole leaf was at hand: an overlaid leaf learns where the key sits
+    if (auto* o = hop.find(leaf)) hopscotch_learn(*o, key);
   }
 
-  ctx.loop->at(done, [&, start, done, op_id, rr0, rw0, rc0, br0, bw0]{ m.ops++; double lat=done-start; m.add_latency(lat); m.dump_op(op_id, "GET", lat, m.remote_reads-rr0, m.remote_writes-rw0, m.remote_cas-rc0, 0, 0, m.bytes_read-br0, m.bytes_write-bw0); });
+  // everything was posted synchronously, so this op's counters are exact here
+  const std::uint64_t reads = m.remote_reads-rr0, writes = m.remote_writes-rw0, cas = m.remote_cas-rc0, br = m.bytes_read-br0, bw = m.bytes_write-bw0;
+  m.add_breakdown(OpType::Get, done - start, ctx.nic->path(ctx.cs_id, ctx.qp, ctx.loop->now));
+  ctx.loop->at(done, [&, start, done, op_id, reads, writes, cas, br, bw]{ m.ops++; double lat=done-start; m.add_latency(lat, done); m.dump_op(op_id, OpType::Get, lat, reads, writes, cas, 0, 0, br, bw); m.on_done(done); if (ctx.sink) ctx.sink->op_done(op_id, done); });
+  return done;
 }
 
-void Sherman::put(std::uint64_t key, Metrics& m, std::uint64_t op_id){
-  if (conf.rdwc.enable) {
-    // Try RDWC delegation for writes
-    auto [is_delegate, entry] = delegation_table.try_delegate_put(key, op_id,
-      [this, key, &m, op_id]() {
-        // This lambda will be executed by the delegate
-        delegate_put_impl(key, m, op_id);
-      });
-    
-    if (!is_delegate) {
-      // This thread's write was combined with the delegate's
-      return;
-    }
-    
-    // This thread is the delegate - execute combined writes
-    if (entry && !entry->pending_writes.empty()) {
-      for (auto& write_op : entry->pending_writes) {
-        write_op(); // Execute each combined write
-      }
-    } else {
-      // Single write case
-      delegate_put_impl(key, m, op_id);
-    }
-    
-    // Complete delegation
-    std::uint64_t key_hash = std::hash<std::uint64_t>{}(key);
-    delegation_table.complete_delegation(key_hash, true, "success");
-    return;
-  }
-  
-  // Original PUT implementation (non-delegated)
-  delegate_put_impl(key, m, op_id);
+// Write path: traverse to the leaf, then lock asynchronously (hocl_acquire);
+// write_locked finishes once the lock is held. The op is identified by its
+// op_id, which also names the issuing thread (op_id % threads).
+void Sherman::delegate_put_impl(std::uint64_t key, Metrics& m, std::uint64_t op_id, SimTime start){
+  auto op = std::make_shared<PutOp>();
+  op->key = key; op->op_id = op_id; op->holder = (std::int64_t)op_id; op->start = start;
+  const OpCost before = OpCost::of(m);
+  SimTime done = ctx.loop->now;
+  std::vector<std::uint64_t> nodes; op->leaf = path_to_leaf(key, nodes);
+  read_path(nodes, (int)nodes.size(), m, done);
+  op->cost += OpCost::of(m) - before;
+  op->path = ctx.nic->path(ctx.cs_id, ctx.qp, ctx.loop->now);
+
+  // the lock is requested once the leaf's address is known
+  ctx.loop->at(done, [this, op, &m]{ hocl_acquire(op, m); });
 }
 
-void Sherman::delegate_put_impl(std::uint64_t key, Metrics& m, std::uint64_t op_id){
-  SimTime start = ctx.loop->now, done = start; int tid = 0; std::uint64_t br0=m.bytes_read, bw0=m.bytes_write; auto rr0=m.remote_reads.load(), rw0=m.remote_writes.load(), rc0=m.remote_cas.load();
-  std::vector<std::uint64_t> nodes; auto leaf = path_to_leaf(key, nodes);
-  for (int lvl=0; lvl<(int)nodes.size(); ++lvl) read_node(nodes[lvl], lvl, m, done);
+void Sherman::write_locked(std::shared_ptr<PutOp> op, Metrics& m){
+  const OpCost before = OpCost::of(m);
+  SimTime done = ctx.loop->now;
+  const std::uint64_t leaf = op->leaf, key = op->key;
+
+  // RDWC: the write-back is posted now, so writes combined into this one stop
+  // joining; writers queued on the slot for another key go again.
+  op->combined = rdwc.close_write(key, [this, &m](const rdwc::DelegationTable::Waiter& w){
+    ctx.loop->after(0, [s = static_cast<Sherman*>(w.issuer), &m, key = w.key, op_id = w.op_id, start = w.start]{ s->put_at(key, m, op_id, start); });
+  });
 
-  // Always acquire a lock (HOCL -> GLT on-chip; disabled -> DRAM)
-  hocl_acquire(leaf, tid, m, done);
+  // Hand-over: a local waiter is queued behind us, so the lock passes to it
+  // directly and nothing is unlocked on the wire (bounded by handover_depth).
+  const bool handover = conf.hocl.enable && conf.hocl.llt_enable && llt.can_hand_over(leaf, conf.hocl.handover_depth);
 
-  if (conf.combine){
+  if (handover){
+    RdmaReq w{Verb::WRITE, Target::DRAM, ctx.leaf_entry_bytes, ctx.qp, ctx.cs_id, ctx.ms_id};
+    auto c = ctx.nic->post(w); done = std::max(done, c.when); m.remote_writes++; m.bytes_write += ctx.leaf_entry_bytes;
+    hocl_release_state_at(leaf, op->holder, c.when, true, m);
+  } else if (conf.combine){
     // Combine write-back + unlock on the same QP (paper’s optimization)
-    Target unlock_target = conf.hocl.enable ? Target::RNIC_ONCHIP : Target::DRAM;
+    Target unlock_target = lock_target(leaf);
     std::vector<RdmaReq> chain = {
       RdmaReq{Verb::WRITE, Target::DRAM,        ctx.leaf_entry_bytes, ctx.qp, ctx.cs_id, ctx.ms_id},
-      RdmaReq{Verb::WRITE, unlock_target,       8,                    ctx.qp, ctx.cs_id, ctx.ms_id}
+      RdmaReq{Verb::WRITE, unlock_target,       8,                    ctx.qp, ctx.cs_id, locks.home(leaf)}
     };
     auto c = ctx.nic->post_chain(chain); done = std::max(done, c.when);
     m.remote_writes += 2; m.bytes_write += (ctx.leaf_entry_bytes + 8);
 
     // Schedule state release exactly when the chain completes
-    hocl_release_state_at(leaf, tid, c.when);
+    hocl_release_state_at(leaf, op->holder, c.when, false, m);
   } else {
     RdmaReq w{Verb::WRITE, Target::DRAM, ctx.leaf_entry_bytes, ctx.qp, ctx.cs_id, ctx.ms_id};
     auto c1 = ctx.nic->post(w); done = std::max(done, c1.when); m.remote_writes++; m.bytes_write += ctx.leaf_entry_bytes;
     // Post unlock and schedule release
-    hocl_release(leaf, tid, m, done);
+    hocl_release(leaf, op->holder, m, done);
   }
 
-  // Update leaf meta (versions, occupancy, splits)
+  // Update leaf meta (versions) and tree occupancy
   auto& meta = leafs[leaf]; if (meta.entry_ver.empty()) meta.entry_ver.resize(leaf_capacity(), 0);
   int idx = (int)(key % leaf_capacity());
   if (conf.enable_two_level_versions) { meta.entry_ver[idx]++; }
   meta.node_ver++;
-  meta.entries = std::min(leaf_capacity(), meta.entries + 1);
-  
-  // Update hopscotch overlay with the new/updated key
-  hopscotch_track_leaf_access(leaf);
-  hopscotch_maybe_create_overlay(leaf, m);
-  hopscotch_update_overlay(leaf, key, idx);
-
-  // Split if above threshold
-  if (conf.enable_splits && meta.entries >= (int)(conf.split_threshold * leaf_capacity())){
-    std::uint64_t sib = leaf ^ 0x5bd1e995u;
-    auto& sm = leafs[sib]; if (sm.entry_ver.empty()) sm.entry_ver.resize(leaf_capacity(), 0);
-    int moved = meta.entries / 2; meta.entries -= moved; sm.entries += moved; meta.node_ver++; sm.node_ver++;
-    
-    // Clear hopscotch overlays on split since entries moved between leaves
-    if (meta.overlay) meta.overlay->clear();
-    if (sm.overlay) sm.overlay->clear();
-
-    if (conf.enable_two_level_versions){
+  // with several shards the tree applies the insert at the window barrier and
+  // the split, if any, follows from there without holding up this write
+  auto split = ctx.tree->insert(leaf, conf.enable_splits ? conf.split_threshold : 2.0, ctx.nic->shard, ctx.loop->now,
+                                [this, leaf, &m](const BTreeModel::Split& s){ split_leaf(leaf, s, m); });
+
+  // an overlaid leaf learns where the written key sits
+  if (auto* ov = hop.find(leaf)) hopscotch_learn(*ov, key);
+
+  done = std::max(done, split_leaf(leaf, split, m));
+
+  op->cost += OpCost::of(m) - before;
+  op->path += ctx.nic->path(ctx.cs_id, ctx.qp, ctx.loop->now);
+  m.add_breakdown(OpType::Put, done - op->start, op->path);
+  ctx.loop->at(done, [this, op, &m, done]{
+    const OpCost& k = op->cost;
+    m.ops++; double lat=done-op->start; m.add_latency(lat, done);
+    m.dump_op(op->op_id, OpType::Put, lat, k.reads, k.writes, k.cas, 0, 0, k.br, k.bw);
+    m.on_done(done); if (ctx.sink) ctx.sink->op_done(op->op_id, done);
+    rdwc.finish(op->combined, [&](const rdwc::DelegationTable::Waiter& w){ finish_combined(OpType::Put, m, w, done); });
+  });
+}
+
+
+// Leaf split (the tree model moved half the entries to a new sibling): bump
+// versions, drop the overlays, write the new nodes. Returns their completion.
+SimTime Sherman::split_leaf(std::uint64_t leaf, const BTreeModel::Split& split, Metrics& m){
+  SimTime done = ctx.loop->now;
+  if (split.sibling == BTreeModel::kNone) return done;
+  auto& meta = leafs[leaf];
+  auto& sm = leafs[split.sibling]; if (sm.entry_ver.empty()) sm.entry_ver.resize(leaf_capacity(), 0);
+  meta.node_ver++; sm.node_ver++;
+
+  // entries moved between the halves: what the overlays knew is void
+  if (auto* ov = hop.find(leaf)) ov->clear();
+  if (auto* ov = hop.find(split.sibling)) ov->clear();
+
+  if (conf.enable_two_level_versions){
+    // sibling + parent separator per split level, plus the new root when the tree grew
+    const int nodes_written = 1 + split.internal_splits + (split.new_root ? 1 : 0);
+    for (int i=0; i<nodes_written; ++i){
       RdmaReq wsib{Verb::WRITE, Target::DRAM, ctx.node_bytes, ctx.qp, ctx.cs_id, ctx.ms_id};
       auto cws = ctx.nic->post(wsib); done = std::max(done, cws.when); m.remote_writes++; m.bytes_write += ctx.node_bytes;
+    }
+    for (int i=0; i<1 + split.internal_splits; ++i){
       RdmaReq wpar{Verb::WRITE, Target::DRAM, 64, ctx.qp, ctx.cs_id, ctx.ms_id};
       auto cwp = ctx.nic->post(wpar); done = std::max(done, cwp.when); m.remote_writes++; m.bytes_write += 64;
     }
   }
-
-  ctx.loop->at(done, [&, start, done, op_id, rr0, rw0, rc0, br0, bw0]{ m.ops++; double lat=done-start; m.add_latency(lat); m.dump_op(op_id, "PUT", lat, m.remote_reads-rr0, m.remote_writes-rw0, m.remote_cas-rc0, 0, 0, m.bytes_read-br0, m.bytes_write-bw0); });
+  return done;
 }
 
-// Hopscotch overlay methods
-void Sherman::hopscotch_maybe_create_overlay(std::uint64_t leaf_id, Metrics& m) {
-  if (!conf.hopscotch.enable) return;
-  
-  auto& meta = leafs[leaf_id];
-  
-  // Create overlay if it doesn't exist and this leaf is hot enough
-  if (!meta.overlay && meta.access_count > 100) { // Simple threshold for now
-    meta.overlay = std::make_unique<hopscotch::HopscotchOverlay>(
-      conf.hopscotch.H, conf.hopscotch.slots_per_leaf);
-      
-    // TODO: Could populate overlay by scanning leaf contents
-    // For now, start with empty overlay that gets populated on subsequent accesses
-  }
+// Range scan: descend to the first leaf through the cache, then read every leaf
+// of the range with one doorbell-batched chain (addresses come from the parents).
+// Leaves are always fetched remotely; no lock, no RDWC.
+void Sherman::scan(std::uint64_t start_key, std::uint32_t len, Metrics& m, std::uint64_t op_id){
+  SimTime start = ctx.loop->now, done = start; std::uint64_t br0=m.bytes_read; auto rr0=m.remote_reads.load();
+  std::vector<std::uint64_t> nodes; path_to_leaf(start_key, nodes);
+  read_path(nodes, (int)nodes.size() - 1, m, done);
+
+  std::vector<std::uint64_t> leaves; ctx.tree->leaves_in_range(start_key, len, leaves);
+  std::vector<RdmaReq> chain(leaves.size(), RdmaReq{Verb::READ, Target::DRAM, ctx.node_bytes, ctx.qp, ctx.cs_id, ctx.ms_id});
+  auto c = ctx.nic->post_chain(chain); done = std::max(done, c.when);
+  m.remote_reads += chain.size(); m.bytes_read += chain.size() * ctx.node_bytes;
+
+  // everything was posted synchronously, so this op's counters are exact here
+  const std::uint64_t reads = m.remote_reads-rr0, br = m.bytes_read-br0;
+  m.add_breakdown(OpType::Scan, done - start, ctx.nic->path(ctx.cs_id, ctx.qp, ctx.loop->now));
+  ctx.loop->at(done, [&, start, done, op_id, reads, br]{
+    m.ops++; double lat=done-start; m.add_latency(lat, done);
+    m.scans++; m.scan_lat_us.add(lat); m.scan_bytes_r += br;
+    m.dump_op(op_id, OpType::Scan, lat, reads, 0, 0, 0, 0, br, 0);
+    m.on_done(done); if (ctx.sink) ctx.sink->op_done(op_id, done);
+  });
 }
 
-void Sherman::hopscotch_update_overlay(std::uint64_t leaf_id, std::uint64_t key, int leaf_slot) {
-  if (!conf.hopscotch.enable) return;
-  
-  auto& meta = leafs[leaf_id];
-  if (meta.overlay) {
-    bool success = meta.overlay->insert(key, leaf_slot);
-    if (!success && meta.overlay->utilization() > conf.hopscotch.rebuild_threshold) {
-      // Overlay is full, consider rebuilding or disabling for this leaf
-      meta.overlay->clear();
-    }
-  }
+// CHIME-style leaf access: the overlay set picks the hottest leaves. A key the
+// overlay knows is read through it when the leaf would otherwise be fetched
+// whole (not in the cache, or stale there).
+hopscotch::HopscotchOverlay* Sherman::hopscotch_leaf(std::uint64_t leaf, int depth, std::uint64_t key){
+  if (!conf.hopscotch.enable) return nullptr;
+  auto* ov = hop.touch(leaf);
+  if (!ov || ov->lookup(key) < 0) return nullptr;
+  std::uint32_t seen = 0;
+  if (cache.peek({leaf, depth}, &seen) && seen == ctx.tree->version(leaf)) return nullptr;
+  return ov;
 }
 
-void Sherman::hopscotch_remove_from_overlay(std::uint64_t leaf_id, std::uint64_t key) {
-  if (!conf.hopscotch.enable) return;
-  
-  auto& meta = leafs[leaf_id];
-  if (meta.overlay) {
-    meta.overlay->remove(key);
-  }
+void Sherman::hopscotch_learn(hopscotch::HopscotchOverlay& ov, std::uint64_t key){
+  if (!ov.insert(key, (std::uint16_t)(key % leaf_capacity())) && ov.utilization() > conf.hopscotch.rebuild_threshold) ov.clear();
 }
 
-int Sherman::hopscotch_probe_overlay(std::uint64_t leaf_id, std::uint64_t key, Metrics& m) {
-  if (!conf.hopscotch.enable) return -1;
-  
-  auto& meta = leafs[leaf_id];
-  if (!meta.overlay) return -1;
-  
-  int leaf_slot = meta.overlay->lookup(key);
-  if (leaf_slot >= 0) {
-    // Overlay hit! This saves us from scanning the full leaf
-    m.hopscotch_hits++; // Add this metric if not already tracked
+// Speculative: read only the hinted slot; the fetched entry's key validates the
+// hint, and a hint made stale by a displacement costs the neighborhood read on
+// top. Without speculation, read the key's neighborhood (H entries).
+// Savings are against the plain path's whole-leaf plus entry read.
+void Sherman::hopscotch_read(hopscotch::HopscotchOverlay& ov, std::uint64_t key, Metrics& m, SimTime& completion){
+  const std::size_t entry = ctx.leaf_entry_bytes;
+  const std::size_t hood = std::min<std::size_t>(ctx.node_bytes, (std::size_t)ov.neighborhood_size() * entry);
+  std::size_t fetched = 0;
+  auto read = [&](std::size_t bytes){
+    RdmaReq r{Verb::READ, Target::DRAM, bytes, ctx.qp, ctx.cs_id, ctx.ms_id};
+    auto c = ctx.nic->post(r); completion = std::max(completion, c.when);
+    m.remote_reads++; m.bytes_read += bytes; fetched += bytes;
+  };
+
+  const int pos = ov.lookup(key);
+  m.hopscotch_hits++;
+  if (!conf.hopscotch.enable_speculative) read(hood);
+  else {
+    read(entry);
+    if (!ov.fresh(pos)){ m.hopscotch_spec_fails++; read(hood); ov.refresh(pos); }
   }
-  return leaf_slot;
+  m.hopscotch_bytes_saved += ctx.node_bytes + entry - fetched;
 }
-
-void Sherman::hopscotch_track_leaf_access(std::uint64_t leaf_id) {
-  if (!conf.hopscotch.enable) return;
-  
-  auto& meta = leafs[leaf_id];
-  meta.access_count++;
-}
\ No newline at end of file
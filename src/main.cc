@@ -1,17 +1,99 @@
 #include "sim/config.h"
 #include "sim/workload.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <filesystem>
 #include <iostream>
+#include <map>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+// Filename prefix for a scenario's per-run files. Sweep points are named
+// "<spec>:<key>=<val>:..." and config stems can repeat, so only filename-safe
+// characters are kept and the scenario index makes the tag unique.
+static std::string file_tag(const std::string& name, std::size_t idx){
+  std::string t;
+  for (char c : name) t += (std::isalnum((unsigned char)c) || c == '-' || c == '.' || c == '_') ? c : '_';
+  return t + "-" + std::to_string(idx) + "_";
+}
+
+static void usage(){
+  std::cerr << "usage: sim [-j N] [--out DIR] [--sweep spec.yaml]... [config.yaml]...\n"
+               "  Runs every (config, workload) pair; pairs execute concurrently on N threads.\n";
+}
 
 int main(int argc, char** argv){
-  std::string cfg = (argc>1? argv[1] : "data/sim.yaml");
-  SimConf conf = LoadConfig(cfg);
-
-  std::string iname = "Sherman";
-  std::cout << "=== Index=" << iname << " ===\n";
-  WorkloadRunner R(conf);
-  for (const auto& wl : conf.workloads){
-    R.run_workload(wl, iname, conf.metrics.out_dir);
+  std::vector<Scenario> scenarios;
+  std::string out_override;
+  int jobs = 0;
+  for (int i=1; i<argc; ++i){
+    std::string a = argv[i];
+    if ((a == "-j" || a == "--jobs") && i+1 < argc) jobs = std::stoi(argv[++i]);
+    else if (a == "--out" && i+1 < argc) out_override = argv[++i];
+    else if (a == "--sweep" && i+1 < argc){ auto v = LoadSweep(argv[++i]); scenarios.insert(scenarios.end(), v.begin(), v.end()); }
+    else if (a == "-h" || a == "--help"){ usage(); return 0; }
+    else scenarios.push_back(Scenario{fs::path(a).stem().string(), LoadConfig(a)});
+  }
+  if (scenarios.empty()) scenarios.push_back(Scenario{"sim", LoadConfig("data/sim.yaml")});
+
+  // One job per (scenario, workload); each builds its own runner (loop, NIC, metrics).
+  struct Job { std::size_t sc, wl; };
+  std::vector<Job> job_list;
+  for (std::size_t s=0; s<scenarios.size(); ++s)
+    for (std::size_t w=0; w<scenarios[s].conf.workloads.size(); ++w) job_list.push_back({s, w});
+
+  const bool multi = scenarios.size() > 1;
+  auto out_dir_of = [&](const Scenario& sc){ return out_override.empty() ? sc.conf.metrics.out_dir : out_override; };
+
+  // metrics_summary.csv has one header per directory, and its percentile
+  // columns follow metrics.ptiles: refuse runs that would mix them.
+  std::map<std::string, std::string> header_of;
+  for (const auto& sc : scenarios){
+    const std::string dir = out_dir_of(sc), h = WorkloadRunner::summary_header(sc.conf.metrics);
+    auto [it, fresh] = header_of.try_emplace(dir, h);
+    if (!fresh && it->second != h){
+      std::cerr << "scenarios writing to " << dir << " differ in metrics.ptiles; give them separate out dirs\n";
+      return 2;
+    }
+    if (fresh && !WorkloadRunner::summary_matches(dir, h)){
+      std::cerr << dir << "/metrics_summary.csv has other columns (metrics.ptiles changed?); move it away first\n";
+      return 2;
+    }
+  }
+
+  std::string inames;
+  for (const auto& sc : scenarios){
+    const std::string n = index_name(sc.conf.index.kind);
+    if (inames.find(n) == std::string::npos) inames += (inames.empty() ? "" : ",") + n;
   }
-  std::cout << "Done. Check " << conf.metrics.out_dir << " for CSV outputs." << std::endl;
+  std::cout << "=== Index=" << inames << " === " << scenarios.size() << " scenario(s), " << job_list.size() << " run(s)\n";
+
+  // Each job owns its result slot, so workers never contend; rows are written
+  // in job order once everything has finished.
+  std::vector<std::string> rows(job_list.size());
+  std::atomic<std::size_t> next{0};
+  auto worker = [&]{
+    for (std::size_t j; (j = next.fetch_add(1)) < job_list.size(); ){
+      const auto& sc = scenarios[job_list[j].sc];
+      WorkloadRunner R(sc.conf);
+      R.scenario = sc.name;
+      if (multi) R.trace_tag = file_tag(sc.name, job_list[j].sc);
+      rows[j] = R.run_workload(sc.conf.workloads[job_list[j].wl], index_name(sc.conf.index.kind), out_dir_of(sc));
+    }
+  };
+  int n = jobs > 0 ? jobs : (int)std::max(1u, std::thread::hardware_concurrency());
+  n = std::min<int>(n, (int)job_list.size());
+  std::vector<std::thread> pool;
+  for (int t=1; t<n; ++t) pool.emplace_back(worker);
+  worker();
+  for (auto& t : pool) t.join();
+
+  std::map<std::string, std::vector<std::string>> by_dir;
+  for (std::size_t j=0; j<job_list.size(); ++j) by_dir[out_dir_of(scenarios[job_list[j].sc])].push_back(rows[j]);
+  for (const auto& [dir, r] : by_dir) WorkloadRunner::append_summary(dir, header_of[dir], r);
+
+  for (const auto& [dir, r] : by_dir) std::cout << "Done. Check " << dir << " for CSV outputs." << std::endl;
   return 0;
 }
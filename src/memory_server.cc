@@ -0,0 +1,20 @@
+#include "sim/memory_server.h"
+#include <algorithm>
+
+// ---- MemoryServer ----
+MemoryServer::MemoryServer(const MemoryConf& c, int cpu_cores)
+  : conf(c),
+    channel(0.1, std::max(1e-9, c.dram_bw_gbps * 1e3 / 8.0)), // bytes per us
+    cores(1.0, std::max(1, cpu_cores)) {}                     // core-us per us
+
+SimTime MemoryServer::dram(SimTime arrive, std::size_t bytes, int shard){
+  return channel.reserve(arrive, double(bytes), 0.0, shard) + conf.dram_lat_us;
+}
+
+SimTime MemoryServer::cpu(SimTime arrive, double service_us, int shard){
+  return cores.reserve(arrive, service_us, service_us, shard);
+}
+
+MemoryPool::MemoryPool(const MemoryConf& c, int memory_nodes, int cpu_cores) : conf(c) {
+  for (int i=0; i<std::max(1, memory_nodes); ++i) servers.push_back(std::make_unique<MemoryServer>(c, cpu_cores));
+}
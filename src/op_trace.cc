@@ -0,0 +1,132 @@
+#include "sim/op_trace.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <zlib.h>
+
+namespace optrace {
+
+namespace {
+constexpr std::size_t kFileBuffer = 1 << 20;
+constexpr std::size_t kInFlight = 4; // chunks queued for the writer thread
+}
+
+Writer::Writer(const std::string& path, const Options& o){
+  f = std::fopen(path.c_str(), "wb");
+  if (!f) throw std::runtime_error("op trace: cannot create " + path);
+  std::setvbuf(f, nullptr, _IOFBF, kFileBuffer);
+  std::memcpy(hdr.magic, kMagic, sizeof kMagic);
+  hdr.version = kVersion;
+  hdr.flags = o.compress ? kCompressed : 0;
+  if (o.reservoir){ hdr.flags |= kReservoir; hdr.sample = o.reservoir; }
+  else if (o.sample_every > 1){ hdr.flags |= kEveryN; hdr.sample = o.sample_every; }
+  else hdr.sample = 1;
+  std::fwrite(&hdr, sizeof hdr, 1, f);
+  chunk.reserve(o.reservoir ? o.reservoir : kChunkRecords);
+  bg = std::thread([this]{ run(); });
+}
+
+Writer::~Writer(){ close(); }
+
+// Algorithm R: the i-th op replaces a random slot with probability K/i.
+void Writer::sample(const Record& r){
+  if (chunk.size() < hdr.sample){ chunk.push_back(r); return; }
+  rng ^= rng << 13; rng ^= rng >> 7; rng ^= rng << 17;
+  const std::uint64_t j = rng % hdr.seen;
+  if (j < hdr.sample) chunk[j] = r;
+}
+
+void Writer::flush(){
+  if (chunk.empty()) return;
+  hdr.records += chunk.size();
+  std::unique_lock<std::mutex> g(mu);
+  cv.wait(g, [&]{ return queue.size() < kInFlight; });
+  queue.push_back(std::move(chunk));
+  g.unlock();
+  cv.notify_all();
+  chunk = {};
+  chunk.reserve(kChunkRecords);
+}
+
+void Writer::run(){
+  std::vector<Bytef> z;
+  for (;;){
+    std::vector<Record> c;
+    {
+      std::unique_lock<std::mutex> g(mu);
+      cv.wait(g, [&]{ return stop || !queue.empty(); });
+      if (queue.empty()) return;
+      c = std::move(queue.front());
+      queue.pop_front();
+    }
+    cv.notify_all();
+    const uLong raw = uLong(c.size() * sizeof(Record));
+    if (hdr.flags & kCompressed){
+      uLongf zn = compressBound(raw);
+      z.resize(zn);
+      compress2(z.data(), &zn, reinterpret_cast<const Bytef*>(c.data()), raw, Z_BEST_SPEED);
+      const std::uint32_t lens[2] = {std::uint32_t(raw), std::uint32_t(zn)};
+      std::fwrite(lens, sizeof lens, 1, f);
+      std::fwrite(z.data(), 1, zn, f);
+    } else {
+      std::fwrite(c.data(), sizeof(Record), c.size(), f);
+    }
+  }
+}
+
+void Writer::close(){
+  if (!f) return;
+  if (hdr.flags & kReservoir){
+    // written in op order, in chunks like any other trace
+    std::vector<Record> all = std::move(chunk);
+    std::sort(all.begin(), all.end(), [](const Record& a, const Record& b){ return a.op_id < b.op_id; });
+    chunk.clear();
+    for (const auto& r : all){ chunk.push_back(r); if (chunk.size() == kChunkRecords) flush(); }
+  }
+  flush();
+  { std::lock_guard<std::mutex> g(mu); stop = true; }
+  cv.notify_all();
+  bg.join();
+  std::fseek(f, 0, SEEK_SET);
+  std::fwrite(&hdr, sizeof hdr, 1, f);
+  std::fclose(f);
+  f = nullptr;
+}
+
+Reader::Reader(const std::string& path){
+  f = std::fopen(path.c_str(), "rb");
+  if (!f) throw std::runtime_error("op trace: cannot open " + path);
+  std::setvbuf(f, nullptr, _IOFBF, kFileBuffer);
+  if (std::fread(&hdr, sizeof hdr, 1, f) != 1 || std::memcmp(hdr.magic, kMagic, sizeof kMagic) != 0 ||
+      hdr.version != kVersion){
+    std::fclose(f); f = nullptr;
+    throw std::runtime_error("op trace: " + path + " is not an op trace");
+  }
+  left = hdr.records;
+}
+
+Reader::~Reader(){ if (f) std::fclose(f); }
+
+bool Reader::next(std::vector<Record>& out){
+  out.clear();
+  if (!left) return false;
+  if (hdr.flags & kCompressed){
+    std::uint32_t lens[2];
+    if (std::fread(lens, sizeof lens, 1, f) != 1 || lens[0] % sizeof(Record))
+      throw std::runtime_error("op trace: truncated chunk header");
+    std::vector<Bytef> z(lens[1]);
+    if (std::fread(z.data(), 1, z.size(), f) != z.size()) throw std::runtime_error("op trace: truncated chunk");
+    out.resize(lens[0] / sizeof(Record));
+    uLongf n = lens[0];
+    if (uncompress(reinterpret_cast<Bytef*>(out.data()), &n, z.data(), lens[1]) != Z_OK || n != lens[0])
+      throw std::runtime_error("op trace: corrupt chunk");
+  } else {
+    out.resize(std::min<std::uint64_t>(left, Writer::kChunkRecords));
+    if (std::fread(out.data(), sizeof(Record), out.size(), f) != out.size())
+      throw std::runtime_error("op trace: truncated");
+  }
+  left -= std::min<std::uint64_t>(left, out.size());
+  return true;
+}
+
+} // namespace optrace
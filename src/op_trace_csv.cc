@@ -0,0 +1,42 @@
+// Prints per-op traces (sim/op_trace.h) as the CSV scripts read:
+//   op_trace_csv out/op_trace_*.optr > ops.csv
+// Several inputs (e.g. the .w<k> files of one run) are concatenated under one
+// header. Sampling details go to stderr.
+#include "sim/op_trace.h"
+#include <cstdio>
+#include <iostream>
+#include <vector>
+
+namespace {
+
+const char* op_name(std::uint8_t t){
+  return t == std::uint8_t(OpType::Get) ? "GET" : t == std::uint8_t(OpType::Scan) ? "SCAN" : "PUT";
+}
+
+void dump(const char* path){
+  optrace::Reader r(path);
+  const auto& h = r.header();
+  std::cerr << path << ": " << h.records << " of " << h.seen << " ops";
+  if (h.flags & optrace::kEveryN) std::cerr << " (1 in " << h.sample << ")";
+  if (h.flags & optrace::kReservoir) std::cerr << " (reservoir of " << h.sample << ")";
+  std::cerr << "\n";
+  std::vector<optrace::Record> batch;
+  while (r.next(batch))
+    for (const auto& o : batch)
+      std::printf("%llu,%s,%.9g,%u,%u,%u,%u,%u,%u,%u\n", (unsigned long long)o.op_id, op_name(o.type), o.latency_us,
+                  o.reads, o.writes, o.cas, o.sends, o.recvs, o.bytes_r, o.bytes_w);
+}
+
+} // namespace
+
+int main(int argc, char** argv){
+  if (argc < 2){ std::cerr << "usage: op_trace_csv in.optr [more.optr ...]\n"; return 2; }
+  std::printf("op_id,type,latency_us,reads,writes,cas,sends,recvs,bytes_r,bytes_w\n");
+  try {
+    for (int i = 1; i < argc; ++i) dump(argv[i]);
+  } catch (const std::exception& e){
+    std::cerr << e.what() << "\n";
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,50 @@
+#include "sim/parallel.h"
+#include <algorithm>
+#include <barrier>
+#include <limits>
+#include <thread>
+
+Pdes::Pdes(int shards, EventQueueKind kind, SimTime lookahead_us)
+  : outbox(std::max(1, shards)), lookahead_(lookahead_us) {
+  for (int s = 0; s < std::max(1, shards); ++s) loops.push_back(std::make_unique<EventLoop>(kind));
+}
+
+void Pdes::send(int src, int dst, SimTime t, EventFn fn){
+  if (src == dst){ loops[dst]->at(t, std::move(fn)); return; }
+  t = std::max(t, loops[src]->now + lookahead_);
+  outbox[src].push_back(Remote{dst, t, std::move(fn)});
+}
+
+// Barrier completion step (runs on exactly one thread while all others wait):
+// run the barrier steps, deliver cross-shard events in source order, then open
+// the next window.
+void Pdes::end_window(){
+  for (auto& fn : barrier_steps) fn();
+  for (auto& q : outbox){
+    for (auto& r : q) loops[r.dst]->at(r.t, std::move(r.fn));
+    q.clear();
+  }
+  SimTime t_min = std::numeric_limits<SimTime>::infinity();
+  for (auto& l : loops){ SimTime t; if (l->next_time(t)) t_min = std::min(t_min, t); }
+  if (t_min == std::numeric_limits<SimTime>::infinity()){ done = true; return; }
+  horizon = t_min + lookahead_;
+  ++windows_;
+}
+
+void Pdes::run(){
+  if (loops.size() == 1){ loops[0]->run(); return; }
+  done = false;
+  end_window();
+  auto step = [this]() noexcept { end_window(); };
+  std::barrier sync(static_cast<std::ptrdiff_t>(loops.size()), step);
+  auto worker = [this, &sync](int s){
+    while (!done){
+      loops[s]->run_until(horizon);
+      sync.arrive_and_wait();
+    }
+  };
+  std::vector<std::thread> threads;
+  for (int s = 1; s < size(); ++s) threads.emplace_back(worker, s);
+  worker(0);
+  for (auto& t : threads) t.join();
+}
@@ -1,10 +1,8 @@
 #include "sim/rdma.h"
+#include "sim/fabric.h"
+#include "sim/memory_server.h"
 
-NIC::NIC(EventLoop& l, const Caps& in_caps) : loop(l), caps(in_caps){
-  nic_tb_read.init(1e12, 1024, loop.now);
-  nic_tb_write.init(1e12, 1024, loop.now);
-  nic_tb_cas.init(1e12, 1024, loop.now);
-}
+NIC::NIC(EventLoop& l, const Caps& in_caps) : loop(l), caps(in_caps){}
 
 double NIC::bytes_per_us() const { return (caps.link_gbps * 1e3) / 8.0; }
 
@@ -25,18 +23,26 @@ Completion NIC::post(const RdmaReq& r){
   }
 
   // 1) host posting costs (descriptor + doorbell; for single WQE, pay both)
+  LatBreakdown path;
   double t = std::max(loop.now, st.post_ready_at);
   t = st.post_ready_at = t + caps.pcie_desc_us + caps.pcie_doorbell_us;
+  path.us[LatBreakdown::Post] = t - loop.now;
 
-  // 2) SQ depth: if full, wait until completion frontier
-  if (st.outstanding >= caps.sq_depth){
-    st.post_ready_at = std::max(st.post_ready_at, st.ready_at);
-    st.outstanding = std::max(0, st.outstanding - 1);
+  // 2) SQ depth: if full, wait until the oldest verb's completion frees a slot
+  const std::size_t depth = std::max(1, caps.sq_depth);
+  auto drain = [&st]{ while (!st.queued.empty() && st.queued.front() <= st.post_ready_at) st.queued.pop_front(); };
+  drain();
+  if (st.queued.size() >= depth){
+    st.post_ready_at = st.queued[st.queued.size() - depth];
+    drain();
   }
+  path.us[LatBreakdown::Sq] = st.post_ready_at - t;
+  st.sq_blocked_us += st.post_ready_at - t;
 
   // 3) token buckets per QP
   auto& tb = pick_bucket(st, r);
   double t_tokens = tb.acquire(1.0, st.post_ready_at);
+  path.us[LatBreakdown::Tokens] = t_tokens - st.post_ready_at;
 
   // 4) wire/NIC service
   SimTime svc = 0.0;
@@ -51,13 +57,61 @@ Completion NIC::post(const RdmaReq& r){
   // 5) completion frontier (in-order per QP)
   SimTime start = std::max({loop.now, st.ready_at, t_tokens});
   SimTime done  = start + svc;
-  st.ready_at = done; st.outstanding++;
-  loop.at(done, [&st]{ st.outstanding = std::max(0, st.outstanding - 1); });
-  return Completion{done};
+  if (fabric){
+    done = through_fabric(r, start);
+  } else if (mem && r.tgt == Target::DRAM && (r.verb == Verb::READ || r.verb == Verb::WRITE || r.verb == Verb::CAS)){
+    // one-sided DRAM access: queue on the server's DRAM channel halfway through the round trip
+    const SimTime half = svc / 2;
+    done = mem->at(r.ms_id).dram(start + half, r.bytes, shard) + half;
+  }
+
+  // Behind a verb posted in the same batch, the path runs through that verb
+  // instead of our own posting; behind anything older it is queueing.
+  if (start > t_tokens){
+    if (st.last_posted == loop.now) path = st.last_path;
+    else path.us[LatBreakdown::Queue] += start - t_tokens;
+  }
+  const SimTime wire = std::min(svc, done - start);
+  path.us[LatBreakdown::Wire] += wire;
+  path.us[LatBreakdown::Queue] += done - start - wire;
+  st.last_posted = loop.now; st.last_path = path;
+
+  st.ready_at = done;
+  st.queued.push_back(done); st.entering.push_back(st.post_ready_at);
+  st.max_outstanding = std::max(st.max_outstanding, (int)st.queued.size());
+  st.verbs++; st.bytes += r.bytes;
+  loop.at(done, [&st, this]{ st.occupy(loop.now, -1); });
+  return Completion{done, path};
+}
+
+LatBreakdown NIC::path(int cs, int qp, SimTime at) const {
+  auto it = qpstate.find((static_cast<long long>(cs) << 32) | qp);
+  return it != qpstate.end() && it->second.last_posted == at ? it->second.last_path : LatBreakdown{};
+}
+
+// Round trip over shared node ports: the requester's message engine and
+// outbound link, half the base RTT, the responder's inbound link and message
+// engine (and DRAM for one-sided access), the response back over the
+// responder's outbound and requester's inbound link, the other half RTT.
+// READ payloads travel on the response, everything else on the request.
+SimTime NIC::through_fabric(const RdmaReq& r, SimTime start){
+  if (r.verb == Verb::RECV) return start; // pre-posted buffer, nothing on the wire
+  Port& src = fabric->cs_port(r.cs_id);
+  Port& dst = r.dst_cs >= 0 ? fabric->cs_port(r.dst_cs) : fabric->ms_port(r.ms_id);
+  const bool onchip = r.verb == Verb::CAS && r.tgt == Target::RNIC_ONCHIP;
+  const SimTime half = (onchip ? caps.cas_onchip_rtt_us : caps.base_rtt_us) / 2;
+  const std::size_t req_bytes  = r.verb == Verb::READ ? 0 : r.bytes;
+  const std::size_t resp_bytes = r.verb == Verb::READ || r.verb == Verb::CAS ? r.bytes : 0;
+
+  SimTime t = src.tx(src.op(start, r.verb, shard), req_bytes, shard);
+  t = dst.op(dst.rx(t + half, req_bytes, shard), r.verb, shard);
+  if (mem && r.tgt == Target::DRAM && r.dst_cs < 0 && r.verb != Verb::SEND) t = mem->at(r.ms_id).dram(t, r.bytes, shard);
+  t = dst.tx(t, resp_bytes, shard);
+  return src.rx(t + half, resp_bytes, shard);
 }
 
 Completion NIC::post_chain(const std::vector<RdmaReq>& chain){
-  if (chain.empty()) return Completion{loop.now};
+  if (chain.empty()) return Completion{loop.now, {}};
   // amortize doorbells: pay descriptors for all, doorbells per batch
   long long key = (static_cast<long long>(chain.front().cs_id) << 32) | chain.front().qp;
   auto& st = qpstate[key];
@@ -66,7 +120,7 @@ Completion NIC::post_chain(const std::vector<RdmaReq>& chain){
   int batches = (n + caps.doorbell_batch_limit - 1) / caps.doorbell_batch_limit;
   t += n * caps.pcie_desc_us + batches * caps.pcie_doorbell_us;
   st.post_ready_at = t;
-  Completion c{loop.now};
+  Completion c{loop.now, {}};
   for (auto& r : chain) c = post(r);
   return c;
 }
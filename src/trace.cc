@@ -0,0 +1,81 @@
+#include "sim/trace.h"
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace trace {
+
+namespace {
+constexpr std::uint64_t kMaxKey = (1ull << 62) - 1;
+constexpr std::size_t kWriteBuffer = 1 << 20;
+}
+
+Reader::Reader(const std::string& path){
+  const int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) throw std::runtime_error("trace: cannot open " + path);
+  struct stat st{};
+  if (::fstat(fd, &st) != 0 || (std::size_t)st.st_size < sizeof(Header)){
+    ::close(fd); throw std::runtime_error("trace: " + path + " is not a trace file");
+  }
+  len = (std::size_t)st.st_size;
+  void* p = ::mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (p == MAP_FAILED) throw std::runtime_error("trace: cannot map " + path);
+  base = static_cast<const unsigned char*>(p);
+  ::madvise(p, len, MADV_SEQUENTIAL);
+
+  std::memcpy(&hdr, base, sizeof hdr);
+  rec_bytes = (hdr.flags & kArrivals) ? 16 : 8;
+  if (std::memcmp(hdr.magic, kMagic, sizeof kMagic) != 0 || hdr.version != kVersion ||
+      sizeof(Header) + hdr.records * rec_bytes > len){
+    ::munmap(p, len); base = nullptr;
+    throw std::runtime_error("trace: " + path + " has a bad header or is truncated");
+  }
+}
+
+Reader::~Reader(){ if (base) ::munmap(const_cast<unsigned char*>(base), len); }
+
+Record Reader::at(std::uint64_t i) const {
+  const unsigned char* r = base + sizeof(Header) + i * rec_bytes;
+  std::uint64_t w; std::memcpy(&w, r, 8);
+  if ((w & 3) > std::uint64_t(OpType::Scan))
+    throw std::runtime_error("trace: record " + std::to_string(i) + " has bad op code " + std::to_string(w & 3));
+  Record out{static_cast<OpType>(w & 3), w >> 2, 0};
+  if (rec_bytes == 16) std::memcpy(&out.arrival_us, r + 8, 8);
+  return out;
+}
+
+Writer::Writer(const std::string& path, bool arrivals){
+  f = std::fopen(path.c_str(), "wb");
+  if (!f) throw std::runtime_error("trace: cannot create " + path);
+  std::setvbuf(f, nullptr, _IOFBF, kWriteBuffer);
+  std::memcpy(hdr.magic, kMagic, sizeof kMagic);
+  hdr.version = kVersion;
+  hdr.flags = arrivals ? kArrivals : 0;
+  std::fwrite(&hdr, sizeof hdr, 1, f);
+}
+
+Writer::~Writer(){ close(); }
+
+void Writer::add(OpType op, std::uint64_t key, SimTime arrival_us){
+  if (key > kMaxKey) throw std::runtime_error("trace: key does not fit in 62 bits");
+  const std::uint64_t w = key << 2 | (std::uint64_t(op) & 3);
+  std::fwrite(&w, 8, 1, f);
+  if (hdr.flags & kArrivals) std::fwrite(&arrival_us, 8, 1, f);
+  hdr.records++;
+  hdr.max_key = std::max(hdr.max_key, key);
+}
+
+void Writer::close(){
+  if (!f) return;
+  std::fseek(f, 0, SEEK_SET);
+  std::fwrite(&hdr, sizeof hdr, 1, f);
+  std::fclose(f);
+  f = nullptr;
+}
+
+} // namespace trace
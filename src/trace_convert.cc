@@ -0,0 +1,99 @@
+// Converts key traces between CSV and the binary replay format (sim/trace.h).
+//   trace_convert in.csv out.trace    CSV lines `op,key[,arrival_us]`; op is one of
+//                                     get/read/r, put/write/update/insert/w, scan/s
+//                                     (a header line and blank lines are skipped;
+//                                     all lines need the columns of the first)
+//   trace_convert --to-csv in.trace   prints the records back as CSV
+// Both directions stream, so traces larger than memory are fine.
+#include "sim/trace.h"
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+
+namespace {
+
+bool parse_op(std::string s, OpType& op){
+  for (auto& c : s) c = (char)std::tolower((unsigned char)c);
+  if (s == "get" || s == "read" || s == "r") op = OpType::Get;
+  else if (s == "put" || s == "write" || s == "update" || s == "insert" || s == "w") op = OpType::Put;
+  else if (s == "scan" || s == "s") op = OpType::Scan;
+  else return false;
+  return true;
+}
+
+const char* op_name(OpType op){ return op == OpType::Get ? "get" : op == OpType::Scan ? "scan" : "put"; }
+
+int to_csv(const char* in){
+  trace::Reader r(in);
+  std::printf(r.has_arrivals() ? "op,key,arrival_us\n" : "op,key\n");
+  for (std::uint64_t i = 0; i < r.size(); ++i){
+    const auto rec = r.at(i);
+    if (r.has_arrivals()) std::printf("%s,%llu,%.9g\n", op_name(rec.op), (unsigned long long)rec.key, rec.arrival_us);
+    else std::printf("%s,%llu\n", op_name(rec.op), (unsigned long long)rec.key);
+  }
+  return 0;
+}
+
+int from_csv(const char* in, const char* out){
+  std::ifstream f(in);
+  if (!f){ std::cerr << "cannot open " << in << "\n"; return 1; }
+  std::string line;
+  std::uint64_t lineno = 0, first = 0;
+  // the first data line decides whether records carry arrival times; every
+  // other line must agree
+  std::unique_ptr<trace::Writer> w;
+  while (std::getline(f, line)){
+    ++lineno;
+    if (!line.empty() && line.back() == '\r') line.pop_back();
+    if (line.empty()) continue;
+    const auto c1 = line.find(',');
+    if (c1 == std::string::npos){ std::cerr << in << ":" << lineno << ": expected op,key[,arrival_us]\n"; return 1; }
+    OpType op;
+    if (!parse_op(line.substr(0, c1), op)){
+      if (lineno == 1) continue; // header
+      std::cerr << in << ":" << lineno << ": unknown op '" << line.substr(0, c1) << "'\n"; return 1;
+    }
+    const auto c2 = line.find(',', c1 + 1);
+    const char* field = line.c_str() + c1 + 1;
+    char* end = nullptr;
+    const std::uint64_t key = std::strtoull(field, &end, 10);
+    if (end == field || (*end && *end != ',')){ std::cerr << in << ":" << lineno << ": bad key\n"; return 1; }
+    double arrival = 0.0;
+    if (c2 != std::string::npos){
+      field = line.c_str() + c2 + 1;
+      arrival = std::strtod(field, &end);
+      if (end == field || *end){ std::cerr << in << ":" << lineno << ": bad arrival_us\n"; return 1; }
+    }
+    const bool arrivals = c2 != std::string::npos;
+    if (!w){ w = std::make_unique<trace::Writer>(out, arrivals); first = lineno; }
+    else if (arrivals != w->has_arrivals()){
+      std::cerr << in << ":" << lineno << ": " << (arrivals ? "unexpected arrival_us" : "missing arrival_us")
+                << " (line " << first << " has " << (arrivals ? "op,key" : "op,key,arrival_us") << ")\n";
+      return 1;
+    }
+    w->add(op, key, arrival);
+  }
+  if (!w) w = std::make_unique<trace::Writer>(out, false);
+  w->close();
+  std::cerr << "wrote " << w->size() << " records to " << out << "\n";
+  return 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv){
+  try {
+    if (argc == 3 && std::strcmp(argv[1], "--to-csv") == 0) return to_csv(argv[2]);
+    if (argc == 3) return from_csv(argv[1], argv[2]);
+  } catch (const std::exception& e){
+    std::cerr << e.what() << "\n";
+    return 1;
+  }
+  std::cerr << "usage: trace_convert in.csv out.trace | trace_convert --to-csv in.trace\n";
+  return 2;
+}
@@ -1,78 +1,393 @@
 #include "sim/workload.h"
 #include "sim/config.h"
+#include "sim/index_dex.h"
 #include "sim/index_sherman.h"
+#include <algorithm>
 #include <random>
 #include <filesystem>
 #include <fstream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
 
 namespace fs = std::filesystem;
 
-WorkloadRunner::WorkloadRunner(const SimConf& c)
-  : conf(c),
-    nic(loop, NIC::Caps{
-      c.nic.link_gbps, c.nic.base_rtt_us, c.nic.per_byte_us, c.nic.cas_onchip_rtt_us,
-      c.nic.in_order_rc, c.nic.qp_per_thread,
-      c.nic.small_threshold, c.nic.doorbell_batch_limit, c.nic.pcie_doorbell_us, c.nic.pcie_desc_us, c.nic.sq_depth,
-      c.nic.tb_cas_ops_per_s, c.nic.tb_read_ops_per_s, c.nic.tb_write_ops_per_s, c.nic.tb_burst_ops
-    }) {
+static NIC::Caps nic_caps(const SimConf& c){
+  return NIC::Caps{
+    c.nic.link_gbps, c.nic.base_rtt_us, c.nic.per_byte_us, c.nic.cas_onchip_rtt_us,
+    c.nic.in_order_rc, c.nic.qp_per_thread,
+    c.nic.small_threshold, c.nic.doorbell_batch_limit, c.nic.pcie_doorbell_us, c.nic.pcie_desc_us, c.nic.sq_depth,
+    c.nic.tb_cas_ops_per_s, c.nic.tb_read_ops_per_s, c.nic.tb_write_ops_per_s, c.nic.tb_burst_ops
+  };
+}
+
+WorkloadRunner::WorkloadRunner(const SimConf& c) : conf(c) {
   metrics.trace_enabled = conf.metrics.dump_per_op_trace;
 }
 
-std::unique_ptr<Index> WorkloadRunner::make_index_for_cs(int cs_id, int ms_id, int qp, std::size_t cache_bytes){
-  IndexCtx ctx{&loop, &nic, cs_id, ms_id, qp, conf.index.node_bytes, conf.index.leaf_entry_bytes};
-  auto sh = conf.index.sh; // copy
+// Contiguous blocks: shard w simulates compute nodes [w*CS/W, (w+1)*CS/W).
+int WorkloadRunner::shard_of_cs(int cs_id) const {
+  const int CS = conf.cluster.compute_nodes, W = (int)shards.size();
+  return (int)((long long)cs_id * W / CS);
+}
+
+// Per compute node and tree depth: hits, misses, resident nodes; level "all"
+// also carries the cache's host memory footprint.
+static void write_cache_stats(const std::string& path, const std::vector<std::unique_ptr<NodeCache>>& caches){
+  std::ofstream out(path);
+  out << "cs,level,hits,misses,hit_ratio,entries,cached_bytes,host_bytes\n";
+  auto ratio = [](std::uint64_t h, std::uint64_t m){ return h + m ? double(h) / double(h + m) : 0.0; };
+  for (std::size_t cs=0; cs<caches.size(); ++cs){
+    NodeCache::LevelStats all;
+    const auto& lv = caches[cs]->levels();
+    for (std::size_t l=0; l<lv.size(); ++l){
+      out << cs << ',' << l << ',' << lv[l].hits << ',' << lv[l].misses << ',' << ratio(lv[l].hits, lv[l].misses) << ','
+          << lv[l].entries << ',' << lv[l].bytes << ",\n";
+      all.hits += lv[l].hits; all.misses += lv[l].misses; all.entries += lv[l].entries;
+    }
+    out << cs << ",all," << all.hits << ',' << all.misses << ',' << ratio(all.hits, all.misses) << ','
+        << all.entries << ',' << caches[cs]->bytes() << ',' << caches[cs]->host_bytes() << "\n";
+  }
+}
+
+// One row per sim-time window; counters are those charged while it was open.
+static void write_timeseries(const std::string& path, Metrics& m, const MetricsCfg& mc){
+  std::ofstream out(path);
+  out << "start_us,end_us,ops,throughput_ops_s,";
+  for (double p : mc.ptiles) out << 'p' << p << "_us,";
+  out << "reads,writes,cas,bytes_r,bytes_w,cache_hits,cache_misses,cache_hit_ratio\n";
+  for (std::size_t i=0; i<m.windows.size(); ++i){
+    auto& w = m.windows[i];
+    const std::uint64_t lookups = w.cache_hits + w.cache_misses;
+    out << i * mc.window_us << ',' << (i + 1) * mc.window_us << ',' << w.ops << ',' << w.ops / mc.window_us * 1e6 << ',';
+    for (double p : mc.ptiles) out << w.pct(p) << ',';
+    out << w.reads << ',' << w.writes << ',' << w.cas << ',' << w.bytes_r << ',' << w.bytes_w << ','
+        << w.cache_hits << ',' << w.cache_misses << ',' << (lookups ? double(w.cache_hits) / double(lookups) : 0.0) << "\n";
+  }
+}
+
+// Per QP, then per compute node's NIC (qp "all": sums, mean outstanding over
+// the node, busiest QP's peak, link utilization of the node's port). Times are
+// sim us; busy and occupancy are over the run's makespan. Returns the totals
+// the summary reports.
+struct QpTotals { double max_busy{0}, sq_blocked_us{0}, tb_starved_us{0}; };
+static QpTotals write_qp_util(const std::string& path, const std::map<long long, const QPState*>& qps, Fabric& fabric, SimTime span){
+  std::ofstream out(path);
+  out << "cs,qp,verbs,bytes,busy,mean_outstanding,max_outstanding,sq_blocked_us,"
+         "tb_read_starved_us,tb_write_starved_us,tb_cas_starved_us,link_util\n";
+  auto frac = [&](double us){ return span > 0 ? us / span : 0.0; };
+  QpTotals tot;
+  QPState node; int node_qps = 0; double node_busy = 0;
+  auto flush = [&](int cs){
+    if (!node_qps) return;
+    const Port& p = fabric.cs_port(cs);
+    out << cs << ",all," << node.verbs << ',' << node.bytes << ',' << frac(node_busy) / node_qps << ','
+        << frac(node.occupancy_us) << ',' << node.max_outstanding << ',' << node.sq_blocked_us << ','
+        << node.tb_read.starved_us << ',' << node.tb_write.starved_us << ',' << node.tb_cas.starved_us << ','
+        << (span > 0 ? double(std::max(p.tx_bytes.load(), p.rx_bytes.load())) / (p.bytes_per_us * span) : 0.0) << "\n";
+    node = QPState{}; node_qps = 0; node_busy = 0;
+  };
+  int cur = -1;
+  for (const auto& [key, st] : qps){
+    const int cs = int(key >> 32), qp = int(key & 0xffffffff);
+    if (cs != cur){ flush(cur); cur = cs; }
+    out << cs << ',' << qp << ',' << st->verbs << ',' << st->bytes << ',' << frac(st->busy_us) << ','
+        << frac(st->occupancy_us) << ',' << st->max_outstanding << ',' << st->sq_blocked_us << ','
+        << st->tb_read.starved_us << ',' << st->tb_write.starved_us << ',' << st->tb_cas.starved_us << ",\n";
+    node.verbs += st->verbs; node.bytes += st->bytes; node_busy += st->busy_us; ++node_qps;
+    node.occupancy_us += st->occupancy_us; node.max_outstanding = std::max(node.max_outstanding, st->max_outstanding);
+    node.sq_blocked_us += st->sq_blocked_us;
+    node.tb_read.starved_us += st->tb_read.starved_us; node.tb_write.starved_us += st->tb_write.starved_us;
+    node.tb_cas.starved_us += st->tb_cas.starved_us;
+    tot.max_busy = std::max(tot.max_busy, frac(st->busy_us));
+    tot.sq_blocked_us += st->sq_blocked_us;
+    tot.tb_starved_us += st->tb_read.starved_us + st->tb_write.starved_us + st->tb_cas.starved_us;
+  }
+  flush(cur);
+  return tot;
+}
+
+// Percentile bands cut at metrics.ptiles: [0,p1), [p1,p2), ..., [pn,100].
+static std::vector<double> band_edges(const MetricsCfg& mc){
+  std::vector<double> e{0};
+  for (double p : mc.ptiles) if (p > 0 && p < 100) e.push_back(p);
+  std::sort(e.begin(), e.end());
+  e.erase(std::unique(e.begin(), e.end()), e.end());
+  e.push_back(100);
+  return e;
+}
+
+// Mean critical-path parts of the ops in each band, per op type and for all ops.
+static void write_breakdown(const std::string& path, const Metrics& m, const MetricsCfg& mc){
+  std::ofstream out(path);
+  out << "type,band,ops,latency_us";
+  for (int p=0; p<LatBreakdown::kParts; ++p) out << ',' << LatBreakdown::name(p) << "_us";
+  out << ",other_us\n";
+  BreakdownHist all;
+  for (const auto& b : m.breakdown) all.merge(b);
+  const char* types[] = {"GET", "PUT", "SCAN", "ALL"};
+  const auto edges = band_edges(mc);
+  for (int t=0; t<4; ++t){
+    const BreakdownHist& h = t < 3 ? m.breakdown[t] : all;
+    for (std::size_t i=0; i+1<edges.size(); ++i){
+      const auto b = h.band(edges[i], edges[i+1]);
+      if (b.n <= 0) continue;
+      out << types[t] << ",p" << edges[i] << "-p" << edges[i+1] << ',' << std::llround(b.n) << ',' << b.lat / b.n;
+      for (double v : b.us) out << ',' << v / b.n;
+      out << "\n";
+    }
+  }
+}
+
+// Lock histograms: wait time (non-empty log buckets, us) and CAS per acquire.
+static void write_lock_stats(const std::string& path, const Metrics& m){
+  std::ofstream out(path);
+  out << "hist,lo,hi,count\n";
+  for (std::size_t i=0; i<Hist::kBuckets; ++i)
+    if (m.lock_wait_us.counts[i])
+      out << "lock_wait_us," << Hist::bucket_lo(i) / 1e3 << ',' << Hist::bucket_hi(i) / 1e3 << ',' << m.lock_wait_us.counts[i] << "\n";
+  for (std::size_t c=0; c<m.cas_per_write.size(); ++c)
+    if (m.cas_per_write[c]) out << "cas_per_write," << c << ',' << c << ',' << m.cas_per_write[c] << "\n";
+}
+
+// Nothing crosses between compute nodes faster than the cheapest verb. Sherman
+// also sends its lock verbs to the GLT's shard when they reach the lock word,
+// and the outcome back, which needs half of that.
+SimTime WorkloadRunner::lookahead_us() const {
+  if (conf.engine.lookahead_us > 0) return conf.engine.lookahead_us;
+  const SimTime rtt = std::max(1e-3, std::min(conf.nic.base_rtt_us, conf.nic.cas_onchip_rtt_us));
+  return conf.index.kind == IndexKind::DEX ? rtt : glt_lead_us();
+}
+
+SimTime WorkloadRunner::glt_lead_us() const {
+  return std::max(1e-3, std::min(conf.nic.base_rtt_us, conf.nic.cas_onchip_rtt_us)) / 2;
+}
+
+std::unique_ptr<Index> WorkloadRunner::make_index_for_cs(Shard& sh, int cs_id, int ms_id, int qp){
+  IndexCtx ctx{&sh.loop, &sh.nic, cs_id, ms_id, qp, conf.index.node_bytes, conf.index.leaf_entry_bytes, nullptr, tree.get()};
+  if (conf.index.kind == IndexKind::DEX){
+    auto dx_conf = conf.index.dx; // copy
+    if (conf.index.ablations.dex.disable_partitioning) dx_conf.logical_partitioning = false;
+    if (conf.index.ablations.dex.disable_path_cache)   dx_conf.path_aware_cache = false;
+    if (conf.index.ablations.dex.disable_offload)      dx_conf.offload.enable = false;
+    auto idx = std::make_unique<Dex>(ctx, dx_conf, *caches[cs_id], *dex);
+    auto& node = dex->cs[cs_id];
+    node.shard = sh.id; node.metrics = &sh.metrics; node.servers.push_back(idx.get());
+    return idx;
+  }
+  auto sh_conf = conf.index.sh; // copy
   // apply ablations
-  if (conf.index.ablations.sherman.disable_combine)  sh.combine = false;
-  if (conf.index.ablations.sherman.disable_hocl)     sh.hocl.enable = false;
-  if (conf.index.ablations.sherman.disable_versions) { sh.enable_two_level_versions = false; sh.two_level_versioning = false; }
-  return std::make_unique<Sherman>(ctx, sh, cache_bytes);
+  if (conf.index.ablations.sherman.disable_combine)  sh_conf.combine = false;
+  if (conf.index.ablations.sherman.disable_hocl)     sh_conf.hocl.enable = false;
+  if (conf.index.ablations.sherman.disable_versions) { sh_conf.enable_two_level_versions = false; sh_conf.two_level_versioning = false; }
+  return std::make_unique<Sherman>(ctx, sh_conf, *caches[cs_id], *locks, *delegations[cs_id], *overlays[cs_id]);
 }
 
-void WorkloadRunner::run_workload(const WorkloadCfg& wl, const std::string& index_name, const std::string& out_dir){
+std::string WorkloadRunner::run_workload(const WorkloadCfg& wl_in, const std::string& index_name, const std::string& out_dir){
   fs::create_directories(out_dir);
-  // reset loop and metrics per workload
-  loop = EventLoop{}; metrics.reset(); metrics.trace_enabled = conf.metrics.dump_per_op_trace;
-  if (metrics.trace_enabled) metrics.open_trace(out_dir+"/op_trace_"+wl.name+"_"+index_name+".csv");
-
+  // a key trace bounds the op count and, unless given, sets the keyspace
+  WorkloadCfg wl = wl_in;
+  key_trace.reset();
+  if (!wl.trace.empty()){
+    key_trace = std::make_unique<trace::Reader>(wl.trace);
+    wl.ops = wl.ops ? std::min<std::uint64_t>(wl.ops, key_trace->size()) : key_trace->size();
+    if (!wl.keyspace) wl.keyspace = key_trace->max_key() + 1;
+  }
   const int CS = conf.cluster.compute_nodes;
   const int TP = conf.cluster.threads_per_compute;
-  indices.clear(); indices.reserve(CS*TP);
-  for (int cs=0; cs<CS; ++cs)
-    for (int th=0; th<TP; ++th)
-      indices.push_back(make_index_for_cs(cs, /*ms=*/cs % conf.cluster.memory_nodes, /*qp=*/th, conf.cluster.cs_cache_bytes));
-
-  Zipf zipf(wl.keyspace, wl.zipf);
-  std::mt19937_64 rng(42);
-  std::uniform_real_distribution<double> U(0.0,1.0);
-
-  for (std::size_t i=0;i<wl.ops;i++){
-    auto& idx = indices[i % indices.size()];
-    bool is_read = (U(rng) < wl.mix.read);
-    std::uint64_t key = zipf.sample(U(rng));
-    loop.after(0, [&, is_read, key, idx_ptr=idx.get(), op_id=i](){
-      if(is_read) idx_ptr->get(key, metrics, op_id);
-      else idx_ptr->put(key, metrics, op_id);
-    });
+  const int W = std::clamp(conf.engine.workers, 1, CS);
+
+  // fresh loops, NICs and metrics per workload
+  metrics.reset(); metrics.trace_enabled = conf.metrics.dump_per_op_trace;
+  shards.clear();
+  dex.reset();
+  pdes = std::make_unique<Pdes>(W, conf.engine.event_queue, lookahead_us());
+  mem = std::make_unique<MemoryPool>(conf.mem, conf.cluster.memory_nodes, conf.cluster.ms_cpu_cores);
+  fabric = std::make_unique<Fabric>(conf.nic, CS, conf.cluster.memory_nodes);
+  mem->shards(W);
+  fabric->shards(W);
+  pdes->at_barrier([this]{ mem->commit(); fabric->commit(); });
+  for (int w=0; w<W; ++w){
+    shards.push_back(std::make_unique<Shard>(w, pdes->loop(w), nic_caps(conf)));
+    shards.back()->nic.mem = mem.get();
+    shards.back()->nic.fabric = fabric.get();
+    auto& m = shards.back()->metrics;
+    m.trace_enabled = conf.metrics.dump_per_op_trace;
+    m.window_us = conf.metrics.window_us;
+    if (m.window_us > 0){
+      m.cache_probe = [this, w]{
+        std::pair<std::uint64_t, std::uint64_t> hm{0, 0};
+        for (int cs=0; cs<(int)caches.size(); ++cs)
+          if (shard_of_cs(cs) == w)
+            for (const auto& l : caches[cs]->levels()){ hm.first += l.hits; hm.second += l.misses; }
+        return hm;
+      };
+      EventLoop& loop = shards.back()->loop;
+      loop.tick_at = 0;
+      loop.on_tick = [&m, &loop]{ m.roll(loop.now); loop.tick_at = double(m.window_of(loop.now) + 1) * m.window_us; };
+    }
+    std::string suffix = (W > 1) ? ".w" + std::to_string(w) : "";
+    if (m.trace_enabled)
+      m.open_trace(out_dir+"/op_trace_"+trace_tag+wl.name+"_"+index_name+suffix+".optr",
+                   optrace::Options{conf.metrics.op_trace_sample_every, conf.metrics.op_trace_reservoir, conf.metrics.op_trace_compress});
+  }
+
+  // one tree shared by every compute node, bulk-loaded to this workload's keyspace
+  const int leaf_cap = conf.index.sh.leaf_max_entries > 0 ? conf.index.sh.leaf_max_entries
+                     : (int)(conf.index.node_bytes / conf.index.leaf_entry_bytes);
+  tree = std::make_unique<BTreeModel>(wl.keyspace, conf.index.node_bytes, conf.index.internal_entry_bytes, leaf_cap, conf.index.bulk_fill);
+  tree->shards(W);
+  pdes->at_barrier([this]{ tree->apply(*pdes); });
+  if (conf.index.kind == IndexKind::DEX){
+    dex = std::make_unique<DexCluster>(conf.index.dx, CS, conf.cluster.memory_nodes, conf.cluster.ms_cpu_cores,
+                                       wl.keyspace, *pdes);
+    dex->shards(W);
+    pdes->at_barrier([this]{ dex->commit(pdes->window_end()); });
+  }
+
+  // Global index order (cs-major) is the op round-robin order for every shard count.
+  std::vector<std::pair<Shard*, Index*>> indices; indices.reserve(CS*TP);
+  caches.clear();
+  const bool is_dex = conf.index.kind == IndexKind::DEX;
+  const CachePolicyKind policy = is_dex ? conf.index.dx.cache_policy : conf.index.sh.cache_policy;
+  const int pinned = is_dex ? conf.index.dx.cache_levels : conf.index.sh.cache_levels;
+  for (int cs=0; cs<CS; ++cs) caches.push_back(std::make_unique<NodeCache>(conf.cluster.cs_cache_bytes, policy, pinned, conf.index.node_bytes));
+  locks = std::make_unique<LockTables>(conf.cluster.memory_nodes, CS, conf.index.sh.hocl.glt_slots, *pdes, glt_lead_us());
+  const auto& rc = conf.index.sh.rdwc;
+  const rdwc::DelegationTable::Config dconf{rc.enable && !is_dex, rc.window_us,
+    rc.collision_policy == ShermanConf::rdwc_t::BYPASS ? rdwc::DelegationTable::Policy::BYPASS
+                                                       : rdwc::DelegationTable::Policy::QUEUE, rc.slots};
+  delegations.clear();
+  for (int cs=0; cs<CS; ++cs) delegations.push_back(std::make_unique<rdwc::DelegationTable>(dconf));
+  const auto& hc = conf.index.sh.hopscotch;
+  const hopscotch::OverlaySet::Conf oconf{hc.enable && !is_dex, hc.H, hc.slots_per_leaf, hc.topK, hc.budget_bytes};
+  overlays.clear();
+  for (int cs=0; cs<CS; ++cs) overlays.push_back(std::make_unique<hopscotch::OverlaySet>(oconf));
+  for (int cs=0; cs<CS; ++cs){
+    auto& sh = *shards[shard_of_cs(cs)];
+    for (int th=0; th<TP; ++th){
+      sh.indices.push_back(make_index_for_cs(sh, cs, /*ms=*/cs % conf.cluster.memory_nodes, /*qp=*/th));
+      indices.emplace_back(&sh, sh.indices.back().get());
+    }
+  }
+
+  Zipf zipf(wl.keyspace, wl.zipf, wl.scramble_keys, wl.zipf_sampler);
+  if (wl.client.mode == ClientMode::Batch){
+    // legacy injection: one global op stream, all at t=0, round-robin over threads
+    std::mt19937_64 rng(42);
+    std::uniform_real_distribution<double> U(0.0,1.0);
+    for (std::size_t i=0;i<wl.ops;i++){
+      auto [sh, idx_ptr] = indices[i % indices.size()];
+      OpType op; std::uint64_t key;
+      if (key_trace){ const auto r = key_trace->at(i); op = r.op; key = r.key % wl.keyspace; }
+      else { op = wl.mix.pick(U(rng)); key = zipf.sample(rng); }
+      sh->metrics.on_issue(0.0);
+      sh->loop.after(0, [&m=sh->metrics, op, key, len=wl.range_len, idx_ptr, op_id=i](){
+        if (op == OpType::Get) idx_ptr->get(key, m, op_id);
+        else if (op == OpType::Scan) idx_ptr->scan(key, len, m, op_id);
+        else idx_ptr->put(key, m, op_id);
+      });
+    }
+  } else {
+    for (std::size_t g=0; g<indices.size(); ++g){
+      auto [sh, idx_ptr] = indices[g];
+      sh->clients.push_back(std::make_unique<ClientThread>(sh->loop, *idx_ptr, sh->metrics, wl, zipf, (int)g, (int)indices.size(),
+                                                                key_trace.get()));
+      idx_ptr->ctx.sink = sh->clients.back().get();
+      sh->clients.back()->start();
+    }
+  }
+  pdes->run();
+  for (auto& sh : shards){ sh->metrics.close_window(); sh->metrics.close_trace(); metrics.merge(sh->metrics); }
+
+  // summary row (appended to metrics_summary.csv by the caller)
+  std::ostringstream out;
+  // throughput over simulated time; offered load is the open-loop target, otherwise the measured issue rate
+  const SimTime span = metrics.makespan_us();
+  fabric->write_util(out_dir+"/port_util_"+trace_tag+wl.name+"_"+index_name+".csv", span);
+  write_cache_stats(out_dir+"/cache_"+trace_tag+wl.name+"_"+index_name+".csv", caches);
+  write_lock_stats(out_dir+"/locks_"+trace_tag+wl.name+"_"+index_name+".csv", metrics);
+  std::map<long long, const QPState*> qps;
+  for (const auto& sh : shards) for (const auto& [key, st] : sh->nic.qpstate) qps[key] = &st;
+  const QpTotals qp_tot = write_qp_util(out_dir+"/qp_util_"+trace_tag+wl.name+"_"+index_name+".csv", qps, *fabric, span);
+  write_breakdown(out_dir+"/breakdown_"+trace_tag+wl.name+"_"+index_name+".csv", metrics, conf.metrics);
+  if (conf.metrics.window_us > 0)
+    write_timeseries(out_dir+"/timeseries_"+trace_tag+wl.name+"_"+index_name+".csv", metrics, conf.metrics);
+  std::uint64_t hits = 0, lookups = 0; std::size_t host = 0;
+  std::vector<NodeCache::LevelStats> by_level;
+  for (const auto& c : caches){
+    const auto& lv = c->levels();
+    if (by_level.size() < lv.size()) by_level.resize(lv.size());
+    for (std::size_t l=0; l<lv.size(); ++l){
+      hits += lv[l].hits; lookups += lv[l].hits + lv[l].misses;
+      by_level[l].hits += lv[l].hits; by_level[l].misses += lv[l].misses;
+    }
+    host += c->host_bytes();
   }
-  loop.run();
+  const double achieved = span > 0 ? metrics.ops.load() / span * 1e6 : 0.0;
+  // (a trace's own arrival times set the open-loop rate)
+  const bool trace_arrivals = key_trace && key_trace->has_arrivals() && wl.client.mode == ClientMode::Open;
+  const SimTime issue_span = metrics.last_issue - metrics.first_issue;
+  const double offered = trace_arrivals ? (issue_span > 0 ? metrics.issued / issue_span * 1e6 : 0.0)
+                       : (wl.client.mode == ClientMode::Open) ? wl.client.rate_ops_per_s
+                       : span > 0 ? metrics.issued / span * 1e6 : 0.0;
+  out << scenario << ',' << index_name << ',' << wl.name << ',' << metrics.ops.load() << ','
+      << span << ',' << offered << ',' << achieved << ',';
+  for (double p : conf.metrics.ptiles) out << metrics.lat_us.pct(p) << ',';
+  out << metrics.remote_reads.load() << ',' << metrics.remote_writes.load() << ',' << metrics.remote_cas.load() << ','
+      << metrics.send_ops.load() << ',' << metrics.recv_ops.load() << ','
+      << metrics.bytes_read.load() << ',' << metrics.bytes_write.load() << ','
+      << tree->height() << ',' << tree->leaves() << ',' << tree->splits() << ',' << metrics.lock_spills.load() << ','
+      << metrics.scans.load() << ',';
+  for (double p : conf.metrics.ptiles) out << metrics.scan_lat_us.pct(p) << ',';
+  out << metrics.scan_bytes_r.load() << ',' << fabric->max_util(span) << ','
+      << (lookups ? double(hits) / double(lookups) : 0.0) << ',' << host << ',';
+  // per-depth counters, root first, ';'-separated so the column count stays fixed
+  for (std::size_t l=0; l<by_level.size(); ++l) out << (l ? ";" : "") << by_level[l].hits;
+  out << ',';
+  for (std::size_t l=0; l<by_level.size(); ++l) out << (l ? ";" : "") << by_level[l].misses;
+  out << ',' << metrics.stale_hits.load() << ',' << metrics.stale_retries.load() << ',' << metrics.lock_retries.load();
+  for (double p : conf.metrics.ptiles) out << ',' << metrics.lock_wait_us.pct(p);
+  out << ',' << metrics.lock_handovers.load() << ',' << metrics.handover_saved_verbs.load();
+  out << ',' << metrics.rdwc_reads.load() << ',' << metrics.rdwc_writes.load();
+  out << ',' << metrics.hopscotch_hits.load() << ',' << metrics.hopscotch_spec_fails.load() << ',' << metrics.hopscotch_bytes_saved.load();
+  // mean critical path of the slowest band (ops at or above the last ptile)
+  BreakdownHist all;
+  for (const auto& b : metrics.breakdown) all.merge(b);
+  const auto edges = band_edges(conf.metrics);
+  const auto tail = all.band(edges[edges.size() - 2], 100);
+  for (double v : tail.us) out << ',' << (tail.n > 0 ? v / tail.n : 0.0);
+  out << ',' << qp_tot.max_busy << ',' << qp_tot.sq_blocked_us << ',' << qp_tot.tb_starved_us;
+  return out.str();
+}
 
-  // summary CSV append
+// Percentile columns follow metrics.ptiles: 50 -> p50_us, 99.9 -> p99.9_us.
+std::string WorkloadRunner::summary_header(const MetricsCfg& mc){
+  std::ostringstream h;
+  h << "scenario,index,workload,ops,sim_time_us,offered_ops_s,throughput_ops_s,";
+  for (double p : mc.ptiles) h << 'p' << p << "_us,";
+  h << "reads,writes,cas,sends,recvs,bytes_r,bytes_w,tree_height,leaves,splits,lock_spills,scans,";
+  for (double p : mc.ptiles) h << "scan_p" << p << "_us,";
+  h << "scan_bytes_r,max_port_util,cache_hit_ratio,cache_host_bytes,cache_level_hits,cache_level_misses,stale_hits,stale_retries,lock_retries";
+  for (double p : mc.ptiles) h << ",lock_wait_p" << p << "_us";
+  h << ",lock_handovers,handover_saved_verbs,rdwc_reads,rdwc_writes,hopscotch_hits,hopscotch_spec_fails,hopscotch_bytes_saved";
+  for (int p=0; p<LatBreakdown::kParts; ++p) h << ",tail_" << LatBreakdown::name(p) << "_us";
+  h << ",tail_other_us,max_qp_busy,sq_blocked_us,tb_starved_us";
+  return h.str();
+}
+
+bool WorkloadRunner::summary_matches(const std::string& out_dir, const std::string& header){
+  std::ifstream in(out_dir+"/metrics_summary.csv");
+  std::string first;
+  return !in || !std::getline(in, first) || first == header;
+}
+
+void WorkloadRunner::append_summary(const std::string& out_dir, const std::string& header, const std::vector<std::string>& rows){
   fs::create_directories(out_dir);
   const std::string sum_path = out_dir+"/metrics_summary.csv";
+  if (!summary_matches(out_dir, header)) throw std::runtime_error(sum_path + ": header does not match metrics.ptiles");
   const bool exists = fs::exists(sum_path);
   std::ofstream out(sum_path, std::ios::app);
-  if (!exists) out << "index,workload,ops,p50_us,p95_us,p99_us,reads,writes,cas,sends,recvs,bytes_r,bytes_w\n";
-  // percentiles
-  double p50=0, p95=0, p99=0;
-  {
-    std::lock_guard<std::mutex> g(metrics.lat_m);
-    p50 = metrics.lat_us.pct(50);
-    p95 = metrics.lat_us.pct(95);
-    p99 = metrics.lat_us.pct(99);
-  }
-  out << index_name << ',' << wl.name << ',' << metrics.ops.load() << ','
-      << p50 << ',' << p95 << ',' << p99 << ','
-      << metrics.remote_reads.load() << ',' << metrics.remote_writes.load() << ',' << metrics.remote_cas.load() << ','
-      << metrics.send_ops.load() << ',' << metrics.recv_ops.load() << ','
-      << metrics.bytes_read.load() << ',' << metrics.bytes_write.load() << "\n";
+  if (!exists) out << header << "\n";
+  for (const auto& r : rows) out << r << "\n";
 }